@@ -0,0 +1,217 @@
+#include "Benchmarks.h"
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+/* Size of a generated source, when no source file is given */
+static const size_t GENERATED_BYTES = 16 * 1024 * 1024;
+
+struct Benchmark
+{
+	const char *name;
+	/* Whether the benchmark's generated source is identifier heavy (see GenerateSource) */
+	bool identifierHeavy;
+	void (*run)(const std::string &source);
+};
+
+static const Benchmark BENCHMARKS[] =
+{
+	{ "lexer", false, Benchmarks::Lexer },
+	{ "keywords", true, Benchmarks::Keywords },
+};
+
+/**
+* Deterministic pseudo random numbers, so every run generates the same source.
+*/
+class Random
+{
+private:
+	uint64_t state;
+
+public:
+	Random(uint64_t seed) : state(seed) {}
+
+	/**
+	* @return a number in [0, bound).
+	*/
+	uint32_t Next(uint32_t bound)
+	{
+		state = state * 6364136223846793005ull + 1442695040888963407ull;
+		return (uint32_t) (state >> 33) % bound;
+	}
+};
+
+/* Identifiers with the length, first & last chars of a keyword, so they hash like it but aren't keywords */
+static const char *const NEAR_KEYWORDS[] =
+{
+	"ease", "edge", "far", "fur", "whale", "write", "brisk", "block", "paint", "point", "region", "reborn",
+	"ball", "bowl", "czar", "veld", "fight", "tree", "tide", "fable", "flame", "conclude", "iat",
+};
+
+static const char *const KEYWORDS[] =
+{
+	"if", "else", "elif", "for", "while", "break", "continue", "print", "return", "true", "false",
+	"void", "int", "float", "bool", "char",
+};
+
+/**
+* Appends a random identifier: a variable name, or if near keywords are wanted, also keywords & near keywords.
+*/
+static void AppendIdentifier(std::string &source, Random &random, bool nearKeywords = false)
+{
+	switch (nearKeywords ? random.Next(4) : 0)
+	{
+	case 1:
+		source += NEAR_KEYWORDS[random.Next(sizeof(NEAR_KEYWORDS) / sizeof(*NEAR_KEYWORDS))];
+		break;
+
+	case 2:
+		source += KEYWORDS[random.Next(sizeof(KEYWORDS) / sizeof(*KEYWORDS))];
+		break;
+
+	default:
+		source += "v" + std::to_string(random.Next(1000));
+		break;
+	}
+}
+
+std::string Benchmarks::GenerateSource(size_t bytes, bool identifierHeavy)
+{
+	static const char *const OPERATORS[] = { " + ", " - ", " * ", " / ", " % ", " == ", " != ", " < ", " >= ", " && ", " || " };
+
+	Random random(identifierHeavy ? 2 : 1);
+	std::string source;
+	source.reserve(bytes + 256);
+
+	size_t depth = 0;
+
+	while (source.length() < bytes)
+	{
+		source.append(depth, '\t');
+
+		if (identifierHeavy)
+		{
+			AppendIdentifier(source, random, true);
+			source += " = ";
+
+			for (uint32_t i = random.Next(8); i > 0; i--)
+			{
+				AppendIdentifier(source, random, true);
+				source += " + ";
+			}
+
+			AppendIdentifier(source, random, true);
+			source += '\n';
+			continue;
+		}
+
+		switch (random.Next(6))
+		{
+		case 0:
+			source += "int ";
+			AppendIdentifier(source, random);
+			source += " = " + std::to_string(random.Next(100)) + OPERATORS[random.Next(5)];
+			AppendIdentifier(source, random);
+			break;
+
+		case 1:
+			AppendIdentifier(source, random);
+			source += " += (";
+			AppendIdentifier(source, random);
+			source += OPERATORS[random.Next(5)] + std::to_string(random.Next(100)) + ")";
+			break;
+
+		case 2:
+			source += "print(";
+			AppendIdentifier(source, random);
+			source += ")";
+			break;
+
+		case 3:
+			source += random.Next(2) == 0 ? "char c = '" + std::string(1, (char) ('a' + random.Next(26))) + "'" : std::string("bool b = true");
+			break;
+
+		case 4:
+			source += "if ";
+			AppendIdentifier(source, random);
+			source += OPERATORS[5 + random.Next(6)];
+			AppendIdentifier(source, random);
+			depth++;
+			break;
+
+		case 5:
+			source += "for int i = 0, i < " + std::to_string(random.Next(100)) + ", i += 1";
+			depth++;
+			break;
+		}
+
+		source += '\n';
+
+		/* Blocks are closed at random, but never nest too deep */
+		if (depth > 0 && (depth > 4 || random.Next(3) == 0))
+		{
+			depth--;
+		}
+	}
+
+	return source;
+}
+
+/**
+* @return the contents of given file, or an empty string if it can't be read.
+*/
+static std::string ReadFile(const char *path)
+{
+	std::ifstream file(path, std::ios::binary);
+	std::stringstream contents;
+	contents << file.rdbuf();
+
+	return contents.str();
+}
+
+int main(int argc, char **argv)
+{
+	if (argc < 2)
+	{
+		std::cout << "Usage: Benchmarks <benchmark|all> [source file]" << std::endl << "Benchmarks:";
+
+		for (const Benchmark &benchmark : BENCHMARKS)
+		{
+			std::cout << " " << benchmark.name;
+		}
+
+		std::cout << std::endl;
+		return 1;
+	}
+
+	bool found = false;
+
+	for (const Benchmark &benchmark : BENCHMARKS)
+	{
+		if (strcmp(argv[1], "all") != 0 && strcmp(argv[1], benchmark.name) != 0)
+		{
+			continue;
+		}
+
+		std::string source = argc > 2 ? ReadFile(argv[2]) : Benchmarks::GenerateSource(GENERATED_BYTES, benchmark.identifierHeavy);
+
+		if (source.empty())
+		{
+			std::cout << "Couldn't read " << argv[2] << std::endl;
+			return 1;
+		}
+
+		benchmark.run(source);
+		found = true;
+	}
+
+	if (!found)
+	{
+		std::cout << "Unknown benchmark " << argv[1] << std::endl;
+		return 1;
+	}
+
+	return 0;
+}
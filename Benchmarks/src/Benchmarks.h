@@ -0,0 +1,57 @@
+#pragma once
+#include <chrono>
+#include <cstddef>
+#include <string>
+
+/**
+* Microbenchmarks of the compiler's hot paths, each run on a source that's either read from a file or generated.
+* They're built separately from the compiler, & only link the sources they measure.
+*/
+namespace Benchmarks
+{
+	/* Every benchmark runs this many times, & reports its best run, which is the least disturbed by the rest of the system */
+	constexpr int RUNS = 5;
+
+	/**
+	* Runs given function RUNS times.
+	*
+	* @return the duration of the fastest run, in seconds.
+	*/
+	template <typename Function>
+	double BestSeconds(Function function)
+	{
+		double best = 0;
+
+		for (int run = 0; run < RUNS; run++)
+		{
+			auto start = std::chrono::steady_clock::now();
+			function();
+			double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+			if (run == 0 || seconds < best)
+			{
+				best = seconds;
+			}
+		}
+
+		return best;
+	}
+
+	/**
+	* Generates a deterministic source of roughly given size, made of declarations, assignments, conditions & loops.
+	*
+	* @param identifierHeavy whether statements should be long chains of identifiers instead, mixing variable names
+	* with keywords & with names that have a keyword's length, first & last chars.
+	*/
+	std::string GenerateSource(size_t bytes, bool identifierHeavy);
+
+	/**
+	* Measures the Tokenizer's throughput (tokens & bytes per second) on given source.
+	*/
+	void Lexer(const std::string &source);
+	/**
+	* Measures keyword recognition (lookups per second) on every identifier in given source: the perfect hash
+	* against the hash map it replaced, checking that both classify every identifier the same.
+	*/
+	void Keywords(const std::string &source);
+}
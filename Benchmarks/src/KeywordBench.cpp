@@ -0,0 +1,86 @@
+#include "Benchmarks.h"
+#include "tokens/Keywords.h"
+#include <cctype>
+#include <iostream>
+#include <unordered_map>
+#include <vector>
+
+/**
+* @return every identifier (and keyword) in given source, viewing into it.
+*/
+static std::vector<std::string_view> FindIdentifiers(const std::string &source)
+{
+	std::vector<std::string_view> identifiers;
+
+	for (size_t i = 0; i < source.length();)
+	{
+		if (!isalpha((unsigned char) source[i]) && source[i] != '_')
+		{
+			i++;
+			continue;
+		}
+
+		size_t start = i;
+
+		while (i < source.length() && (isalnum((unsigned char) source[i]) || source[i] == '_'))
+		{
+			i++;
+		}
+
+		identifiers.push_back(std::string_view(source).substr(start, i - start));
+	}
+
+	return identifiers;
+}
+
+void Benchmarks::Keywords(const std::string &source)
+{
+	std::vector<std::string_view> identifiers = FindIdentifiers(source);
+
+	/* The Tokenizer's lookup before the perfect hash */
+	std::unordered_map<std::string_view, TokenType> map;
+
+	for (const Keywords::Keyword &keyword : Keywords::KEYWORDS)
+	{
+		map.emplace(keyword.text, keyword.type);
+	}
+
+	/* Sums of the found TokenTypes, so the lookups can't be optimized away, & both ways can be compared */
+	size_t hashSum = 0, mapSum = 0;
+
+	double hashSeconds = BestSeconds([&]()
+	{
+		hashSum = 0;
+
+		for (std::string_view identifier : identifiers)
+		{
+			hashSum += (size_t) Keywords::Lookup(identifier);
+		}
+	});
+
+	double mapSeconds = BestSeconds([&]()
+	{
+		mapSum = 0;
+
+		for (std::string_view identifier : identifiers)
+		{
+			auto iterator = map.find(identifier);
+			mapSum += (size_t) (iterator == map.end() ? TokenType::ID : iterator->second);
+		}
+	});
+
+	std::cout << "keywords: " << identifiers.size() << " identifiers, perfect hash " << identifiers.size() / hashSeconds / 1e6
+		<< " M/s, hash map " << identifiers.size() / mapSeconds / 1e6 << " M/s" << std::endl;
+
+	/* Both must classify every identifier the same */
+	for (std::string_view identifier : identifiers)
+	{
+		auto iterator = map.find(identifier);
+
+		if (hashSum != mapSum || Keywords::Lookup(identifier) != (iterator == map.end() ? TokenType::ID : iterator->second))
+		{
+			std::cout << "keywords: MISMATCH on " << identifier << std::endl;
+			return;
+		}
+	}
+}
@@ -0,0 +1,17 @@
+#include "Benchmarks.h"
+#include "tokens/Tokenizer.h"
+#include <iostream>
+
+void Benchmarks::Lexer(const std::string &source)
+{
+	size_t tokenCount = 0;
+
+	double seconds = BestSeconds([&]()
+	{
+		Tokenizer tokenizer(source);
+		tokenCount = tokenizer.ScanTokens().Size();
+	});
+
+	std::cout << "lexer: " << tokenCount << " tokens in " << seconds * 1000 << " ms, "
+		<< tokenCount / seconds / 1e6 << " Mtok/s, " << source.length() / seconds / 1e6 << " MB/s" << std::endl;
+}
@@ -1,68 +1,268 @@
 #include <iostream>
 #include "tokens/Tokenizer.h"
+#include "tokens/TokenStream.h"
 #include "Parser/Parser.h"
 #include "compiler/Compiler.h"
+#include "compiler/CompileServer.h"
 #include "asm/ASMRunner.h"
-#include <chrono>
+#include "util/MappedFile.h"
+#include "cache/BuildCache.h"
+#include "util/Profiler.h"
 #include <fstream>
 
 std::string ReadFile(std::string filePath)
 {
     std::string source;
 
-    std::ifstream sourceFile(filePath);
+    std::ifstream sourceFile(filePath, std::ios::binary);
 
-    std::string curLine;
-    while (std::getline(sourceFile, curLine))
-        source += curLine + '\n';
+    if (!sourceFile)
+        return source;
+
+    /* Size the string once & read the whole file into it in a single call */
+    sourceFile.seekg(0, std::ios::end);
+    source.resize(static_cast<size_t>(sourceFile.tellg()));
+    sourceFile.seekg(0, std::ios::beg);
+    sourceFile.read(&source[0], source.size());
 
     sourceFile.close();
 
     return source;
 }
 
-void CompileAndExecute(const std::string &sourceDir, const std::string &outputDir, const std::string &projectName)
+/* How the source file is fed to the Tokenizer */
+enum class SourceMode
 {
-    /* Read source file content */
-    std::string sourceContent = ReadFile(sourceDir + projectName + ".txt");
+    /* Read the whole file into memory, then tokenize it */
+    BUFFERED,
+    /* Tokenize the file in fixed-size chunks on a background thread, while the Parser consumes the Tokens */
+    STREAMED,
+    /* Map the file into memory & tokenize directly from the mapped pages, without copying it */
+    MAPPED,
+};
 
-    /* Create path to output Assembly file, expect it to end with .asm extension */
-    std::string outputAsmPath = outputDir + projectName + ".asm";
+/**
+* Parses given Tokens & compiles them into ASM code. Incremental compilations reuse the code of the top-level blocks that didn't change since the last one.
+*
+* @param tokens the Tokens of the program.
+* @param blocksPath the file that keeps the blocks of the last incremental compilation.
+* @param incremental whether to reuse & keep blocks. Filling the cache makes a first build about twice as slow as a full one,
+* and the file is rewritten on every build, so only repeated builds of large programs benefit from it.
+* @param profiler receives the phases of the compilation & its counters.
+*/
+CodeBuffer CompileTokens(TokenBuffer &tokens, const std::string &blocksPath, bool incremental, Profiler &profiler)
+{
+    ThreadPool pool;
+
+    if (!incremental)
+    {
+        /* Owns the variables & visitor state. Everything is released at once when compilation is done */
+        Arena arena;
+        FlatAst ast;
+
+        /* Second stage: Parse Tokens & Build AST, large programs in parallel */
+        Profiler::Phase parsePhase(&profiler, "parse");
+        ParseExprs(tokens, ast, &pool);
+        parsePhase.End();
+
+        profiler.Add("tokens", tokens.Size());
 
-    /* Begin compilation benchmark */
-    auto compilationStart = std::chrono::high_resolution_clock::now();
+        /* Third stage: Compile AST into ASM code, large programs in parallel */
+        Profiler::Phase codegenPhase(&profiler, "codegen");
+        return Compile(ast, tokens, arena, &pool, &profiler);
+    }
 
-    /* First stage: Scan Tokens  */
-    Tokenizer tokenizer(sourceContent);
-    std::vector<Token> tokens = tokenizer.ScanTokens();
+    BlockCache blocks;
+    ReuseReport report;
 
-    /* Second stage: Parse Tokens & Build AST */
-    ExprGroup *block = ParseExprs(tokens);
+    {
+        /* A missing or outdated file just means that every block is compiled */
+        Profiler::Phase phase(&profiler, "loadBlocks");
+        blocks.Load(blocksPath, COMPILER_VERSION);
+    }
 
-    /* Third stage: Compile AST into ASM code */
-    std::string compiled = Compile(block);
+    /* Second & third stages: Parse the changed blocks & compile them into ASM code, in parallel */
+    CodeBuffer compiled = CompileIncremental(tokens, blocks, &pool, report, &profiler);
 
-    /* End compilation benchmark & print result */
-    auto compilationEnd  = std::chrono::high_resolution_clock::now();
-    std::cout << "\nCompilation Time: " << std::chrono::duration_cast<std::chrono::nanoseconds>(compilationEnd - compilationStart).count() << "ns\n";
+    {
+        Profiler::Phase phase(&profiler, "saveBlocks");
+        blocks.Save(blocksPath, COMPILER_VERSION);
+    }
 
-    /* Write ASM code into output file */
-    std::ofstream file(outputAsmPath);
-    file << compiled;
-    file.close();
+    std::cout << "\nReused " << report.reusedBlocks << '/' << report.blocks << " blocks, "
+        << report.reusedTokens << '/' << report.tokens << " tokens, "
+        << report.reusedCodeBytes << '/' << report.codeBytes << " code bytes\n";
 
-    /* Run compiled ASM file */
+    return compiled;
+}
+
+/**
+* Writes the profile of a build as JSON, for tracking the compiler's performance across releases.
+*/
+void WriteProfile(Profiler &profiler, const std::string &profilePath)
+{
+    std::ofstream file(profilePath);
+    profiler.WriteJson(file);
+
+    std::cout << "\nProfile written to " << profilePath << "\n";
+}
+
+void CompileAndExecute(const std::string &sourceDir, const std::string &outputDir, const std::string &projectName, SourceMode mode = SourceMode::BUFFERED, bool incremental = false)
+{
+    std::string sourcePath = sourceDir + projectName + ".txt";
+    std::string profilePath = outputDir + projectName + ".profile.json";
+
+    /* Measures every phase of the build, from reading the source to running the EXE */
+    Profiler profiler;
+
+    /* Read source file content. Streamed & mapped sources are read during compilation instead */
+    std::string sourceContent;
+    if (mode == SourceMode::BUFFERED)
+    {
+        Profiler::Phase phase(&profiler, "read");
+        sourceContent = ReadFile(sourcePath);
+    }
+
+    /* Create path to output Assembly file, expect it to end with .asm extension */
+    std::string outputAsmPath = outputDir + projectName + ASMRunner::ASM_EXTENSION;
+
+    /* Everything built from the source, in the order the cache stores it */
+    std::vector<std::filesystem::path> builtFiles = {
+        outputAsmPath,
+        outputDir + projectName + ASMRunner::OBJ_EXTENSION,
+        outputDir + projectName + ASMRunner::EXE_EXTENSION,
+    };
+
+    /* Key the build by the source's content, and by everything else that affects the built files */
+    std::vector<std::string> buildOptions = { COMPILER_VERSION, ASMRunner::ASSEMBLER, ASMRunner::LINKER };
+    std::string cacheKey;
+
+    BuildCache cache(outputDir + "cache");
     ASMRunner runner(outputDir, projectName);
-    runner.Execute();
+
+    Profiler::Phase restorePhase(&profiler, "restoreBuild");
+
+    if (mode == SourceMode::BUFFERED)
+    {
+        cacheKey = BuildCache::Key(sourceContent, buildOptions);
+    }
+    else
+    {
+        /* Hash straight from the mapped pages; the source is read again during compilation only on a miss */
+        MappedFile sourceFile(sourcePath);
+        cacheKey = BuildCache::Key(sourceFile.View(), buildOptions);
+    }
+
+    /* Identical builds skip compiling, assembling & linking altogether */
+    if (cache.Restore(cacheKey, builtFiles))
+    {
+        restorePhase.End();
+        std::cout << "\nRestored build " << cacheKey << " from cache\n";
+
+        {
+            Profiler::Phase phase(&profiler, "run");
+            runner.Run();
+        }
+
+        WriteProfile(profiler, profilePath);
+        return;
+    }
+
+    restorePhase.End();
+
+    CodeBuffer compiled;
+    std::string blocksPath = outputDir + projectName + ".blocks";
+
+    if (mode == SourceMode::STREAMED)
+    {
+        /* First stage: Scan Tokens on a background thread, while they're parsed. Reading the file is part of it */
+        TokenStream stream(sourcePath);
+        TokenBuffer tokens(stream);
+
+        compiled = CompileTokens(tokens, blocksPath, incremental, profiler);
+
+        /* Lexing overlaps parsing, so it has no phase of its own. Its time is counted instead */
+        tokens.Fill();
+        profiler.Add("lexMicros", stream.ScanMicros());
+    }
+    else if (mode == SourceMode::MAPPED)
+    {
+        /* First stage: Scan Tokens. Tokens view into the mapped pages, so the mapping must outlive them */
+        Profiler::Phase readPhase(&profiler, "read");
+        MappedFile sourceFile(sourcePath);
+        readPhase.End();
+
+        Profiler::Phase lexPhase(&profiler, "lex");
+        Tokenizer tokenizer(sourceFile.View());
+        TokenBuffer tokens(tokenizer.ScanTokens());
+        lexPhase.End();
+
+        compiled = CompileTokens(tokens, blocksPath, incremental, profiler);
+    }
+    else
+    {
+        /* First stage: Scan Tokens. Tokens view into sourceContent, so it must outlive them */
+        Profiler::Phase lexPhase(&profiler, "lex");
+        Tokenizer tokenizer(sourceContent);
+        TokenBuffer tokens(tokenizer.ScanTokens());
+        lexPhase.End();
+
+        compiled = CompileTokens(tokens, blocksPath, incremental, profiler);
+    }
+
+    {
+        /* Write ASM code into output file, straight from the code's pages */
+        Profiler::Phase phase(&profiler, "write");
+        std::ofstream file(outputAsmPath);
+        compiled.WriteTo(file);
+        file.close();
+
+        profiler.Add("asmBytes", compiled.Size());
+    }
+
+    /* Build compiled ASM file & cache the built files for identical builds */
+    runner.Build(&profiler);
+
+    {
+        Profiler::Phase phase(&profiler, "storeBuild");
+        cache.Store(cacheKey, builtFiles);
+    }
+
+    {
+        /* Run compiled ASM file */
+        Profiler::Phase phase(&profiler, "run");
+        runner.Run();
+    }
+
+    WriteProfile(profiler, profilePath);
 }
 
-int main()
+int main(int argc, char **argv)
 {
+    /* Server mode: compile batches of programs from stdin into stdout until stdin ends */
+    if (argc > 1 && std::string(argv[1]) == "--serve")
+    {
+        CompileServer server;
+        server.Serve(std::cin, std::cout, std::cerr);
+        return 0;
+    }
+
     std::string sourceDir = "E:\\Workspace\\VisualStudio\\C++\\LightweightCompilerRefactor\\TestProject\\";
     std::string outputDir = "E:\\Workspace\\VisualStudio\\C++\\LightweightCompilerRefactor\\TestProject\\out\\";
     std::string projectName = "example";
+
+    /* Reusing unchanged blocks between builds is opt-in, as it only pays off for repeated builds of large programs */
+    bool incremental = argc > 1 && std::string(argv[1]) == "--incremental";
     
-    CompileAndExecute(sourceDir, outputDir, projectName);
+    try
+    {
+        CompileAndExecute(sourceDir, outputDir, projectName, SourceMode::BUFFERED, incremental);
+    }
+    catch (const CompileError &error)
+    {
+        std::cerr << error.what();
+        return 1;
+    }
     /*ASMRunner runner(outputDir, projectName);
     runner.Execute();*/
 }
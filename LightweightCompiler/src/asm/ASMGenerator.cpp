@@ -1,179 +1,157 @@
 #include "ASMGenerator.h"
+#include "ASMPrinter.h"
+#include "../tables/VarTable.h"
 
-const std::string ASMGenerator::LABEL_PREFIX = "L";
-
-std::string ASMGenerator::CreateLabel(const size_t labelIndex)
+ASMOffset ASMGenerator::StackOffset(const Var *var) const
 {
-	return LABEL_PREFIX + std::to_string(labelIndex);
-}
+	if (var->declaration != Var::NOT_IMPORTED)
+	{
+		return ASMOffset{ true, var->declaration };
+	}
 
-ASMGenerator::ASMGenerator()
-{
-	this->code = "";
-	this->labelCount = 0;
+	return ASMOffset{ false, var->memOffset };
 }
 
-ASMGenerator *ASMGenerator::instance = NULL;
-
-ASMGenerator *ASMGenerator::GetInstance()
+ASMOperand ASMGenerator::VarOperand(const Var *var) const
 {
-	if (instance == NULL)
+	if (var->reg != Var::IN_MEMORY)
 	{
-		instance = new ASMGenerator();
+		return var->reg;
 	}
 
-	return instance;
+	return ASMOperand::Mem(ASMSize::DWORD, StackOffset(var));
 }
 
-std::string GetReg(const ASMReg reg)
+void ASMGenerator::Flush(CodeBuffer &output)
 {
-	switch (reg)
-	{
-	case ASMReg::EAX:
-		return "eax";
-
-	case ASMReg::EBX:
-		return "ebx";
-
-	case ASMReg::ECX:
-		return "ecx";
+	Peephole(instructions, peephole);
 
-	case ASMReg::EDX:
-		return "edx";
+	ASMPrinter printer(output, texts, relocatable);
+	printer.Print(instructions);
 
-	default:
-		return "Unimplemented Register";
-	}
+	instructions.clear();
+	texts.clear();
 }
 
-std::string GetInstr(const ASMInstr instr)
+ASMGenerator::ASMGenerator(bool relocatable) :
+	relocatable(relocatable)
 {
-	switch (instr)
-	{
-	case ASMInstr::MOV:
-		return "MOV";
-
-	case ASMInstr::PUSH:
-		return "PUSH";
-
-	case ASMInstr::POP:
-		return "POP";
-
-	case ASMInstr::ADD:
-		return "ADD";
-
-	case ASMInstr::SUB:
-		return "SUB";
-
-	case ASMInstr::IMUL:
-		return "IMUL";
-
-	case ASMInstr::IDIV:
-		return "IDIV";
-
-	case ASMInstr::AND:
-		return "AND";
-
-	case ASMInstr::OR:
-		return "OR";
+	this->labelCount = 0;
+}
 
-	case ASMInstr::NEG:
-		return "NEG";
+void ASMGenerator::AppendLabel(ASMLabel label, bool inlined)
+{
+	uint8_t flags = inlined ? ASMInstruction::INLINE : 0;
 
-	case ASMInstr::NOT:
-		return "NOT";
+	instructions.push_back(ASMInstruction{ ASMInstr::LABEL, flags, label, ASMOperand(), ASMInstruction::NO_COMMENT });
+}
 
-	default:
-		return "Unimplemented Instruction";
-	}
+void ASMGenerator::AppendSpace()
+{
+	Append(ASMInstr::SPACE);
 }
 
-void ASMGenerator::Append(const std::string code)
+void ASMGenerator::AppendComment(const char *comment)
 {
-	this->code += code;
+	Append(ASMInstr::COMMENT, ASMOperand(), comment);
 }
 
-void ASMGenerator::AppendLine(const std::string code)
+void ASMGenerator::AppendDirective(const char *directive)
 {
-	Append(code + '\n');
+	Append(ASMInstr::DIRECTIVE, ASMOperand(), directive);
 }
 
-void ASMGenerator::AppendSpace()
+ASMLabel ASMGenerator::GenerateLabel()
 {
-	AppendLine("");
+	return ASMLabel{ labelCount++ };
 }
 
-void ASMGenerator::AppendComment(const std::string comment)
+int ASMGenerator::LabelCount() const
 {
-	AppendLine(";; " + comment);
+	return labelCount;
 }
 
-std::string ASMGenerator::GenerateLabel()
+ASMOperand ASMGenerator::Literal(std::string_view literal)
 {
-	return CreateLabel(labelCount++);
+	/* Literals that are written the way a number is printed (no leading zeros, up to 9 digits so they fit) are kept as numbers */
+	int32_t value = 0;
+	bool canonical = !literal.empty() && literal.length() <= 9 && (literal[0] != '0' || literal.length() == 1);
+
+	for (size_t i = 0; canonical && i < literal.length(); i++)
+	{
+		canonical = literal[i] >= '0' && literal[i] <= '9';
+		value = value * 10 + (literal[i] - '0');
+	}
+
+	if (canonical)
+	{
+		return ASMOperand::Imm(value);
+	}
+
+	texts.push_back(literal);
+	return ASMOperand::Text(texts.size() - 1);
 }
 
-int ASMGenerator::LabelCount() const
+void ASMGenerator::PushValue(std::string_view literal)
 {
-	return labelCount;
+	Append(ASMInstr::PUSH, Literal(literal));
 }
 
-void ASMGenerator::PushValue(const std::string value)
+void ASMGenerator::PushValue(int32_t value)
 {
-	AppendLine("PUSH " + value);
+	Append(ASMInstr::PUSH, ASMOperand::Imm(value));
 }
 
 void ASMGenerator::PopValue(const ASMReg reg)
 {
-	AppendLine("POP " + GetReg(reg));
+	Append(ASMInstr::POP, reg);
 }
 
 void ASMGenerator::AppendUnary(const ASMInstr instr)
 {
 	/* Avoid using EAX in unary instructions; a lot of them use EAX implicitly */
-	AppendLine("POP edx");
-	AppendLine(GetInstr(instr) + " edx");
-	AppendLine("PUSH edx");
+	Append(ASMInstr::POP, ASMReg::EDX);
+	Append(instr, ASMReg::EDX);
+	Append(ASMInstr::PUSH, ASMReg::EDX);
 }
 
 void ASMGenerator::AppendBinary(const ASMInstr instr)
 {
-	AppendLine("POP eax");
-	AppendLine("POP ebx");
-	AppendLine(GetInstr(instr) + " eax, ebx");
-	AppendLine("PUSH eax");
+	Append(ASMInstr::POP, ASMReg::EAX);
+	Append(ASMInstr::POP, ASMReg::ECX);
+	Append(instr, ASMReg::EAX, ASMReg::ECX);
+	Append(ASMInstr::PUSH, ASMReg::EAX);
 }
 
 void ASMGenerator::EnterLoop()
 {
-	std::string loopLabel = CreateLabel(labelCount++);
+	ASMLabel loopLabel = GenerateLabel();
 
 	AppendComment("-------- Entering Loop --------");
-	AppendLine("POP ecx");
-	AppendLine(loopLabel + ":");
+	AppendLabel(loopLabel);
 }
 
 void ASMGenerator::ExitLoop()
 {
-	std::string loopLabel = CreateLabel(labelCount - 1);
+	ASMLabel loopLabel{ labelCount - 1 };
 
-	AppendLine("LOOP " + loopLabel);
+	Append(ASMInstr::LOOP, loopLabel);
 	AppendComment("----------------------------------------");
 }
 
 void ASMGenerator::EnterMethod()
 {
 	AppendComment("Method Prologue");
-	AppendLine("PUSH ebp");
-	AppendLine("MOV ebp, esp");
+	Append(ASMInstr::PUSH, ASMReg::EBP);
+	Append(ASMInstr::MOV, ASMReg::EBP, ASMReg::ESP);
 }
 
 void ASMGenerator::ExitMethod()
 {
 	AppendComment("Method Epilogue");
-	AppendLine("MOV esp, ebp");
-	AppendLine("POP ebp");
-	AppendLine("RET");
+	Append(ASMInstr::MOV, ASMReg::ESP, ASMReg::EBP);
+	Append(ASMInstr::POP, ASMReg::EBP);
+	Append(ASMInstr::RET);
 }
 
 void ASMGenerator::FilePrologue()
@@ -184,13 +162,13 @@ void ASMGenerator::FilePrologue()
 	AppendLine("start:");
 	AppendSpace();*/
 
-	AppendLine("%include \"E:\\Workspace\\VisualStudio\\C++\\LightweightCompilerRefactor\\TestProject\\out\\lib.asm\"");
+	AppendDirective("%include \"E:\\Workspace\\VisualStudio\\C++\\LightweightCompilerRefactor\\TestProject\\out\\lib.asm\"");
 	AppendSpace();
-	AppendLine("section .text");
+	AppendDirective("section .text");
 	AppendSpace();
-	AppendLine("global _main");
+	AppendDirective("global _main");
 	AppendSpace();
-	AppendLine("_main:");
+	AppendDirective("_main:");
 }
 
 void ASMGenerator::FileEpilogue()
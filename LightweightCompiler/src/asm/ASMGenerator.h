@@ -1,64 +1,115 @@
 #pragma once
-#include <string>
+#include <string_view>
+#include <vector>
+#include "ASMInstruction.h"
+#include "Peephole.h"
+#include "../util/CodeBuffer.h"
 
-enum class ASMReg
-{
-	EAX,
-	EBX,
-	ECX,
-	EDX,
-};
-
-std::string GetReg(ASMReg reg);
-
-enum class ASMInstr
-{
-	MOV,
-	PUSH,
-	POP,
-
-	ADD,
-	SUB,
-	IMUL,
-	IDIV,
-	AND,
-	OR,
-
-	NEG,
-	NOT,
-};
-
-std::string GetInstr(ASMInstr instr);
+struct Var;
 
 class ASMGenerator
 {
 private:
-	static ASMGenerator *instance;
-	static const std::string LABEL_PREFIX;
 	size_t labelCount;
-	ASMGenerator();
-public:
-	static ASMGenerator *GetInstance();
-
-	static std::string CreateLabel(const size_t labelIndex);
+	/**
+	* Whether this generator emits code for a part of the program, which is joined with other parts later.
+	* Such code numbers its labels & variable offsets from 0, and is printed so they can be relocated by the part's position in the program (see ASMPrinter).
+	*/
+	const bool relocatable;
 
-	std::string code;
+public:
+	ASMGenerator(bool relocatable = false);
+
+	/* The generated code, in order */
+	std::vector<ASMInstruction> instructions;
+	/* Comments, and literals of the code that are written as they appear in the source */
+	std::vector<std::string_view> texts;
+	/* What the peephole pass did to all the code flushed so far */
+	PeepholeStats peephole;
+
+	/**
+	* @return the index of given text among the texts, or NO_COMMENT if it's NULL.
+	*/
+	uint32_t AddText(const char *text)
+	{
+		if (text == NULL)
+		{
+			return ASMInstruction::NO_COMMENT;
+		}
+
+		texts.push_back(text);
+		return (uint32_t) texts.size() - 1;
+	}
+
+	/**
+	* @return the offset of given variable from ebp.
+	*/
+	ASMOffset StackOffset(const Var *var) const;
+	/**
+	* @return an operand of given DWORD variable: the register that holds it, or its memory.
+	*/
+	ASMOperand VarOperand(const Var *var) const;
+
+	/**
+	* Optimizes the code generated so far with the peephole pass, writes it as NASM code, and clears it. Flushing often keeps the instructions few & in cache.
+	* The pass never looks across a flush, so code must only be flushed between statements.
+	*
+	* @param output receives the code.
+	*/
+	void Flush(CodeBuffer &output);
+
+	/**
+	* Appends an instruction with up to 2 operands, destination first.
+	*
+	* @param comment written after the instruction, or NULL.
+	* @return the appended instruction, valid until the next one is appended.
+	*/
+	ASMInstruction &Append(ASMInstr instr, ASMOperand dst = ASMOperand(), const char *comment = NULL)
+	{
+		return instructions.emplace_back(ASMInstruction{ instr, 0, dst, ASMOperand(), AddText(comment) });
+	}
+
+	ASMInstruction &Append(ASMInstr instr, ASMOperand dst, ASMOperand src, const char *comment = NULL)
+	{
+		return instructions.emplace_back(ASMInstruction{ instr, 0, dst, src, AddText(comment) });
+	}
+
+	/**
+	* Defines given label at the current position.
+	*
+	* @param inlined whether the label shares its line with the next instruction.
+	*/
+	void AppendLabel(ASMLabel label, bool inlined = false);
 
-	void Append(const std::string code);
-	void AppendLine(const std::string code);
 	void AppendSpace();
 
-	void AppendComment(const std::string comment);
+	void AppendComment(const char *comment);
+
+	/**
+	* Appends a line of the assembler's own syntax, as is.
+	*/
+	void AppendDirective(const char *directive);
 
-	std::string GenerateLabel();
+	ASMLabel GenerateLabel();
 	int LabelCount() const;
 
-	void PushValue(const std::string value);
+	/**
+	* @return an operand of an integer literal, as written in the source.
+	*/
+	ASMOperand Literal(std::string_view literal);
+	/**
+	* Pushes an integer literal, as written in the source.
+	*/
+	void PushValue(std::string_view literal);
+	void PushValue(int32_t value);
 	void PopValue(const ASMReg reg);
 
 	void AppendUnary(const ASMInstr instr);
 	void AppendBinary(const ASMInstr instr);
 
+	/**
+	* Starts a loop that runs as many times as ecx holds.
+	*/
 	void EnterLoop();
 	void ExitLoop();
 
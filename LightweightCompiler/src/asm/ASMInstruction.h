@@ -0,0 +1,173 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+enum class ASMReg : uint8_t
+{
+	EAX,
+	EBX,
+	ECX,
+	EDX,
+	ESI,
+	EDI,
+	EBP,
+	ESP,
+
+	/* Low parts of EAX */
+	AX,
+	AL,
+};
+
+/* Amount of ASMRegs */
+constexpr size_t ASM_REG_COUNT = (size_t) ASMReg::AL + 1;
+
+enum class ASMInstr : uint8_t
+{
+	MOV,
+	MOVZX,
+	PUSH,
+	POP,
+
+	ADD,
+	SUB,
+	IMUL,
+	IDIV,
+	AND,
+	OR,
+
+	NEG,
+	NOT,
+
+	CMP,
+	JMP,
+	JZ,
+	JNZ,
+	JE,
+	JNE,
+	JG,
+	JGE,
+	JL,
+	JLE,
+	LOOP,
+	CALL,
+	RET,
+
+	/* Not instructions: lines of the code that don't execute anything */
+	LABEL, // Defines the label of its operand
+	COMMENT, // A whole line comment
+	SPACE, // An empty line
+	DIRECTIVE, // A line of the assembler's own syntax, written as is
+};
+
+/* A label of the generated code, by its index among the generator's labels */
+struct ASMLabel
+{
+	size_t index;
+};
+
+/* The offset of a variable from ebp, as known while its code is generated */
+struct ASMOffset
+{
+	/* Whether the variable was declared by another part of the program, in which case the value is its position among the part's imports */
+	bool imported;
+	size_t value;
+};
+
+/* A routine defined outside the generated code (in the included library) */
+enum class ASMSymbol : uint8_t
+{
+	PRINT_NUMBER,
+	PRINT_BOOL,
+};
+
+/* Width of a memory operand */
+enum class ASMSize : uint8_t
+{
+	BYTE = 1,
+	WORD = 2,
+	DWORD = 4,
+};
+
+/**
+* A single operand of an ASMInstruction. Registers, labels & symbols convert to operands implicitly, the other kinds are made by the static methods.
+*/
+struct ASMOperand
+{
+	enum Kind : uint8_t
+	{
+		NONE,
+		REG,
+		IMM, // A number
+		TEXT, // A literal kept as written in the source, by its index among the generator's texts
+		MEM, // A variable, at an offset from ebp
+		LABEL,
+		SYMBOL,
+	};
+
+	Kind kind;
+	ASMReg reg;
+	ASMSize size;
+	/* Whether a MEM operand's offset is imported (see ASMOffset) */
+	bool imported;
+
+	union
+	{
+		int32_t imm;
+		/* TEXT index, MEM offset, LABEL index or ASMSymbol */
+		uint32_t value;
+	};
+
+	ASMOperand() : kind(NONE), reg(ASMReg::EAX), size(ASMSize::DWORD), imported(false), value(0) {}
+	ASMOperand(ASMReg reg) : kind(REG), reg(reg), size(ASMSize::DWORD), imported(false), value(0) {}
+	ASMOperand(ASMLabel label) : kind(LABEL), reg(ASMReg::EAX), size(ASMSize::DWORD), imported(false), value((uint32_t) label.index) {}
+	ASMOperand(ASMSymbol symbol) : kind(SYMBOL), reg(ASMReg::EAX), size(ASMSize::DWORD), imported(false), value((uint32_t) symbol) {}
+
+	static ASMOperand Imm(int32_t imm)
+	{
+		ASMOperand operand;
+		operand.kind = IMM;
+		operand.imm = imm;
+		return operand;
+	}
+
+	static ASMOperand Text(size_t index)
+	{
+		ASMOperand operand;
+		operand.kind = TEXT;
+		operand.value = (uint32_t) index;
+		return operand;
+	}
+
+	static ASMOperand Mem(ASMSize size, ASMOffset offset)
+	{
+		ASMOperand operand;
+		operand.kind = MEM;
+		operand.size = size;
+		operand.imported = offset.imported;
+		operand.value = (uint32_t) offset.value;
+		return operand;
+	}
+};
+
+/**
+* A single line of generated code: an instruction with up to 2 operands (destination first), or a line that isn't an instruction.
+* Instructions are small & stored by value in a contiguous list, and are only turned into text by an ASMPrinter.
+*/
+struct ASMInstruction
+{
+	/* Comment of an instruction that has none */
+	static constexpr uint32_t NO_COMMENT = UINT32_MAX;
+
+	/* Flags of an instruction */
+	enum : uint8_t
+	{
+		/* A LABEL that shares its line with the next instruction */
+		INLINE = 1,
+	};
+
+	ASMInstr instr;
+	uint8_t flags;
+	ASMOperand dst, src;
+	/* Index among the generator's texts of a comment written after the instruction, or of the text of a COMMENT or DIRECTIVE */
+	uint32_t comment;
+};
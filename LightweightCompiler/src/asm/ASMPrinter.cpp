@@ -0,0 +1,294 @@
+#include "ASMPrinter.h"
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+
+/**
+* A name that's copied as a whole word: the name's chars are padded to 8, and all 8 are copied, so copying doesn't depend on the name's length.
+* The output has room for the padding, which is overwritten by whatever follows the name.
+*/
+struct PaddedName
+{
+	char chars[8];
+	size_t length;
+
+	std::string_view View() const
+	{
+		return std::string_view(chars, length);
+	}
+};
+
+/* Names by enum value */
+static const PaddedName REG_NAMES[] = { { "eax", 3 }, { "ebx", 3 }, { "ecx", 3 }, { "edx", 3 }, { "esi", 3 }, { "edi", 3 }, { "ebp", 3 }, { "esp", 3 }, { "ax", 2 }, { "al", 2 } };
+static const PaddedName INSTR_NAMES[] =
+{
+	{ "MOV", 3 }, { "MOVZX", 5 }, { "PUSH", 4 }, { "POP", 3 },
+	{ "ADD", 3 }, { "SUB", 3 }, { "IMUL", 4 }, { "IDIV", 4 }, { "AND", 3 }, { "OR", 2 },
+	{ "NEG", 3 }, { "NOT", 3 },
+	{ "CMP", 3 }, { "JMP", 3 }, { "JZ", 2 }, { "JNZ", 3 }, { "JE", 2 }, { "JNE", 3 }, { "JG", 2 }, { "JGE", 3 }, { "JL", 2 }, { "JLE", 3 },
+	{ "LOOP", 4 }, { "CALL", 4 }, { "RET", 3 },
+};
+static const PaddedName SIZE_NAMES[] = { { "", 0 }, { "BYTE", 4 }, { "WORD", 4 }, { "", 0 }, { "DWORD", 5 } };
+static const std::string_view SYMBOL_NAMES[] = { "print_number", "print_bool" };
+
+/* Longest line without the texts it writes: an instruction's name, 2 memory operands with markers & 10 digit offsets, and padding */
+static const size_t MAX_LINE = 64;
+/* Space reserved at once for the lines that follow */
+static const size_t RESERVE_LENGTH = 4096;
+
+std::string_view GetReg(const ASMReg reg)
+{
+	return REG_NAMES[(size_t) reg].View();
+}
+
+std::string_view GetInstr(const ASMInstr instr)
+{
+	if ((size_t) instr >= sizeof(INSTR_NAMES) / sizeof(INSTR_NAMES[0]))
+	{
+		return "Unimplemented Instruction";
+	}
+
+	return INSTR_NAMES[(size_t) instr].View();
+}
+
+static char *Write(char *to, const PaddedName &name)
+{
+	memcpy(to, name.chars, sizeof(name.chars));
+	return to + name.length;
+}
+
+static char *Write(char *to, std::string_view text)
+{
+	memcpy(to, text.data(), text.length());
+	return to + text.length();
+}
+
+static char *WriteNumber(char *to, uint32_t number)
+{
+	size_t length = 1;
+	for (uint32_t rest = number / 10; rest != 0; rest /= 10) length++;
+
+	for (char *digit = to + length; digit != to; number /= 10)
+	{
+		*--digit = (char) ('0' + number % 10);
+	}
+
+	return to + length;
+}
+
+ASMPrinter::ASMPrinter(CodeBuffer &output, const std::vector<std::string_view> &texts, bool relocatable) :
+	output(output),
+	texts(texts),
+	relocatable(relocatable)
+{
+}
+
+char *ASMPrinter::Put(char *to, const ASMOperand &operand) const
+{
+	switch (operand.kind)
+	{
+	case ASMOperand::REG:
+		return Write(to, REG_NAMES[(size_t) operand.reg]);
+
+	case ASMOperand::IMM:
+		if (operand.imm < 0)
+		{
+			*to++ = '-';
+			return WriteNumber(to, 0 - (uint32_t) operand.imm);
+		}
+
+		return WriteNumber(to, operand.imm);
+
+	case ASMOperand::MEM:
+		to = Write(to, SIZE_NAMES[(size_t) operand.size]);
+		to = Write(to, " [ebp-");
+
+		/* Written to the same reserved space, so a marker & its number are never split between pages */
+		if (operand.imported)
+		{
+			*to++ = IMPORT_MARKER;
+		}
+		else if (relocatable)
+		{
+			*to++ = OFFSET_MARKER;
+		}
+
+		to = WriteNumber(to, operand.value);
+		*to++ = ']';
+		return to;
+
+	case ASMOperand::LABEL:
+		*to++ = relocatable ? LABEL_MARKER : LABEL_PREFIX;
+		return WriteNumber(to, operand.value);
+
+	case ASMOperand::TEXT:
+		return Write(to, texts[operand.value]);
+
+	case ASMOperand::SYMBOL:
+		return Write(to, SYMBOL_NAMES[operand.value]);
+
+	default:
+		return to;
+	}
+}
+
+char *ASMPrinter::Print(char *to, const ASMInstruction &instruction) const
+{
+	switch (instruction.instr)
+	{
+	case ASMInstr::SPACE:
+		*to++ = '\n';
+		return to;
+
+	case ASMInstr::COMMENT:
+		to = Write(to, ";; ");
+		to = Write(to, texts[instruction.comment]);
+		*to++ = '\n';
+		return to;
+
+	case ASMInstr::DIRECTIVE:
+		to = Write(to, texts[instruction.comment]);
+		*to++ = '\n';
+		return to;
+
+	case ASMInstr::LABEL:
+		to = Put(to, instruction.dst);
+		*to++ = ':';
+		*to++ = (instruction.flags & ASMInstruction::INLINE) != 0 ? ' ' : '\n';
+		return to;
+
+	default:
+		break;
+	}
+
+	to = Write(to, INSTR_NAMES[(size_t) instruction.instr]);
+
+	if (instruction.dst.kind != ASMOperand::NONE)
+	{
+		*to++ = ' ';
+		to = Put(to, instruction.dst);
+
+		if (instruction.src.kind != ASMOperand::NONE)
+		{
+			to = Write(to, ", ");
+			to = Put(to, instruction.src);
+		}
+	}
+
+	if (instruction.comment != ASMInstruction::NO_COMMENT)
+	{
+		*to++ = ' ';
+		to = Write(to, texts[instruction.comment]);
+	}
+
+	*to++ = '\n';
+	return to;
+}
+
+size_t ASMPrinter::TextLength(const ASMInstruction &instruction) const
+{
+	size_t length = instruction.comment == ASMInstruction::NO_COMMENT ? 0 : texts[instruction.comment].length();
+
+	if (instruction.dst.kind == ASMOperand::TEXT) length += texts[instruction.dst.value].length();
+	if (instruction.src.kind == ASMOperand::TEXT) length += texts[instruction.src.value].length();
+
+	return length;
+}
+
+void ASMPrinter::Print(const std::vector<ASMInstruction> &instructions)
+{
+	/* Lines are written directly to space that's reserved for many of them at once. A line takes at most MAX_LINE besides its texts */
+	char *start = NULL, *end = NULL, *limit = NULL;
+
+	for (const ASMInstruction &instruction : instructions)
+	{
+		size_t length = MAX_LINE + TextLength(instruction);
+
+		if ((size_t) (limit - end) < length)
+		{
+			output.Advance(end - start);
+
+			length = std::max(length, RESERVE_LENGTH);
+			start = end = output.Reserve(length);
+			limit = start + length;
+		}
+
+		end = Print(end, instruction);
+	}
+
+	output.Advance(end - start);
+}
+
+/**
+* @return index of the first marker (a char up to IMPORT_MARKER) at or after given index, or the code's length if there's none.
+* Markers are rare, so the code is checked 8 chars at a time.
+*/
+static size_t FindMarker(std::string_view code, size_t index)
+{
+	const uint64_t ones = 0x0101010101010101ULL, highs = 0x8080808080808080ULL;
+
+	for (; index + 8 <= code.length(); index += 8)
+	{
+		uint64_t word;
+		memcpy(&word, code.data() + index, 8);
+
+		/* Sets the high bit of (at least) the first char that's below 4 */
+		if (((word - ones * 4) & ~word & highs) != 0)
+		{
+			break;
+		}
+	}
+
+	while (index < code.length() && (unsigned char) code[index] > 3)
+	{
+		index++;
+	}
+
+	return index;
+}
+
+void ASMPrinter::Relocate(std::string_view code, size_t labelBase, size_t offsetBase, const std::vector<size_t> &importOffsets, CodeBuffer &output)
+{
+	static_assert(IMPORT_MARKER == 3, "FindMarker looks for chars up to 3");
+
+	size_t i = 0;
+
+	while (i < code.length())
+	{
+		/* Copy everything up to the next marker as is */
+		size_t marker = FindMarker(code, i);
+
+		output.Append(code.substr(i, marker - i));
+
+		if (marker == code.length()) break;
+
+		/* Read the marked number */
+		size_t value = 0;
+		for (i = marker + 1; i < code.length() && code[i] >= '0' && code[i] <= '9'; i++)
+		{
+			value = value * 10 + (code[i] - '0');
+		}
+
+		switch (code[marker])
+		{
+		case LABEL_MARKER:
+			output.Append(LABEL_PREFIX);
+			output.AppendNumber(labelBase + value);
+			break;
+
+		case OFFSET_MARKER:
+			output.AppendNumber(offsetBase + value);
+			break;
+
+		case IMPORT_MARKER:
+			output.AppendNumber(importOffsets[value]);
+			break;
+
+		default:
+			/* Not a marker (NUL) */
+			output.Append(code[marker]);
+			i = marker + 1;
+			break;
+		}
+	}
+}
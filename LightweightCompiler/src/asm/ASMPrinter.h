@@ -0,0 +1,65 @@
+#pragma once
+#include <string_view>
+#include <vector>
+#include "ASMInstruction.h"
+#include "../util/CodeBuffer.h"
+
+std::string_view GetReg(ASMReg reg);
+std::string_view GetInstr(ASMInstr instr);
+
+/**
+* Writes ASMInstructions as NASM code.
+*/
+class ASMPrinter
+{
+private:
+	static constexpr char LABEL_PREFIX = 'L';
+	/* Markers that precede the numbers of relocatable code, followed by the number's digits. Control characters never appear in generated code otherwise */
+	static constexpr char LABEL_MARKER = '\x01', OFFSET_MARKER = '\x02', IMPORT_MARKER = '\x03';
+
+	CodeBuffer &output;
+	/* Texts that the instructions refer to: comments & TEXT operands */
+	const std::vector<std::string_view> &texts;
+	/**
+	* Whether the code is a part of the program, which is joined with other parts later.
+	* Its labels & variable offsets are numbered from 0, and marked so they can be relocated by the part's position in the program.
+	*/
+	const bool relocatable;
+
+	/**
+	* Writes given operand to given space of the output.
+	*
+	* @return the end of the written operand.
+	*/
+	char *Put(char *to, const ASMOperand &operand) const;
+	/**
+	* @return the length of the texts that given instruction writes.
+	*/
+	size_t TextLength(const ASMInstruction &instruction) const;
+	/**
+	* Writes given instruction's line to given space of the output.
+	*
+	* @return the end of the written line.
+	*/
+	char *Print(char *to, const ASMInstruction &instruction) const;
+
+public:
+	ASMPrinter(CodeBuffer &output, const std::vector<std::string_view> &texts, bool relocatable = false);
+
+	/**
+	* Writes given instructions, one line each. A line is never split between pages, so neither are the markers of relocatable code & their numbers.
+	*/
+	void Print(const std::vector<ASMInstruction> &instructions);
+
+	/**
+	* Appends relocatable code to given output, resolving its markers.
+	* The code may be given in parts (e.g. the pages of a CodeBuffer), as long as no marker is split from its number.
+	*
+	* @param code code of a relocatable printer.
+	* @param labelBase the amount of labels generated before this code.
+	* @param offsetBase the amount of stack bytes allocated before this code.
+	* @param importOffsets the final offset of every imported variable, by its position in the code's imports.
+	* @param output receives the resolved code.
+	*/
+	static void Relocate(std::string_view code, size_t labelBase, size_t offsetBase, const std::vector<size_t> &importOffsets, CodeBuffer &output);
+};
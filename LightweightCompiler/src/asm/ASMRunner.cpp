@@ -1,6 +1,12 @@
 #include "ASMRunner.h"
 #include <iostream>
-#include <chrono>
+#include <cstdio>
+
+const char *const ASMRunner::ASM_EXTENSION = ".asm";
+const char *const ASMRunner::OBJ_EXTENSION = ".obj";
+const char *const ASMRunner::EXE_EXTENSION = ".exe";
+const char *const ASMRunner::ASSEMBLER = "nasm -fwin32";
+const char *const ASMRunner::LINKER = "gcc";
 
 ASMRunner::ASMRunner(const std::string &outputDir, const std::string &projectName) :
 	outputDir(outputDir),
@@ -8,24 +14,43 @@ ASMRunner::ASMRunner(const std::string &outputDir, const std::string &projectNam
 {
 }
 
-void ASMRunner::Execute()
+void ASMRunner::Build(Profiler *profiler)
 {
-	std::string asmPath = outputDir + projectName + ".asm";
-	std::string objPath = outputDir + projectName + ".obj";
-	std::string exePath = outputDir + projectName + ".exe";
+	std::string asmPath = outputDir + projectName + ASM_EXTENSION;
+	std::string objPath = outputDir + projectName + OBJ_EXTENSION;
+	std::string exePath = outputDir + projectName + EXE_EXTENSION;
+
+	/* Remove files of previous builds, so a failed build doesn't leave them behind */
+	remove(objPath.c_str());
+	remove(exePath.c_str());
+
+	/* Compile ASM code to OBJ, then compile OBJ to EXE. Each tool runs on its own, so each is measured on its own */
+	std::string assemble = std::string(ASSEMBLER) + ' ' + asmPath;
+	std::string link = std::string(LINKER) + ' ' + objPath + " -o " + exePath;
+
+	{
+		Profiler::Phase phase(profiler, "assemble");
+		system(assemble.c_str());
+	}
+
+	{
+		Profiler::Phase phase(profiler, "link");
+		system(link.c_str());
+	}
+}
 
-	/* Compile ASM code to OBJ, then compile OBJ to EXE */
-	std::string compile = "nasm -fwin32 " + asmPath + " & gcc " + objPath + " -o " + exePath;
-	/* Execute command */
-	system(compile.c_str());
+void ASMRunner::Run()
+{
+	std::string exePath = outputDir + projectName + EXE_EXTENSION;
 
 	std::cout << "Output:\n";
 
-	/* Begin EXE runtime benchmark */
-	auto start = std::chrono::high_resolution_clock::now();
 	/* Execute EXE file */
 	system(exePath.c_str());
-	/* End EXE runtime benchmark & print result. Kinda useless benchmark */
-	auto finish = std::chrono::high_resolution_clock::now();
-	std::cout << "\nExecution Time: " << std::chrono::duration_cast<std::chrono::nanoseconds>(finish - start).count() << "ns\n";
+}
+
+void ASMRunner::Execute()
+{
+	Build();
+	Run();
 }
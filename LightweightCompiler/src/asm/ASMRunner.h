@@ -1,5 +1,6 @@
 #pragma once
 #include <string>
+#include "../util/Profiler.h"
 
 class ASMRunner
 {
@@ -8,6 +9,29 @@ private:
 	const std::string &projectName;
 
 public:
+	/* Extensions of the files produced from a project's ASM file, in build order */
+	static const char *const ASM_EXTENSION;
+	static const char *const OBJ_EXTENSION;
+	static const char *const EXE_EXTENSION;
+	/* Tools that assemble the ASM file & link the OBJ file, with their options. Anything that changes them changes the built files */
+	static const char *const ASSEMBLER;
+	static const char *const LINKER;
+
 	ASMRunner(const std::string &outputDir, const std::string &projectName);
+
+	/**
+	* Assembles the project's ASM file to OBJ, then links the OBJ to EXE.
+	* If either step fails, the files it should have built don't exist afterwards.
+	*
+	* @param profiler receives the assemble & link phases, or NULL to measure nothing.
+	*/
+	void Build(Profiler *profiler = NULL);
+	/**
+	* Runs the project's EXE file.
+	*/
+	void Run();
+	/**
+	* Builds & runs the project.
+	*/
 	void Execute();
 };
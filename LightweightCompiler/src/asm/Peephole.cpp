@@ -0,0 +1,391 @@
+#include "Peephole.h"
+
+/* How many instructions a rule looks back at most, so every instruction is optimized in constant time */
+static const size_t MAX_DISTANCE = 16;
+
+/* Registers as bits of a mask, the low parts of a register being the register itself */
+static const unsigned REG_BITS[] = { 1, 2, 4, 8, 16, 32, 64, 128, 1, 1 };
+static const unsigned EAX_BIT = 1, EDX_BIT = 8, EBP_BIT = 64, ESP_BIT = 128;
+
+/* What an instruction reads & writes */
+struct Effects
+{
+	unsigned reads, writes;
+	bool readsMemory, writesMemory;
+	/* Whether code can't be moved across the instruction: it's a label, jumps, or uses the stack */
+	bool barrier;
+};
+
+static bool Executes(const ASMInstruction &instruction)
+{
+	return instruction.instr < ASMInstr::LABEL;
+}
+
+static bool IsJump(ASMInstr instr)
+{
+	return instr >= ASMInstr::JMP && instr <= ASMInstr::JLE;
+}
+
+static bool IsFullReg(const ASMOperand &operand)
+{
+	return operand.kind == ASMOperand::REG && operand.reg <= ASMReg::ESP;
+}
+
+static bool SameOperand(const ASMOperand &a, const ASMOperand &b)
+{
+	return a.kind == b.kind && a.reg == b.reg && a.size == b.size && a.imported == b.imported && a.value == b.value;
+}
+
+/* How an instruction uses its operands & the registers it uses implicitly */
+struct Usage
+{
+	bool readsDst, writesDst, readsSrc;
+	unsigned reads, writes;
+	bool barrier;
+};
+
+/* Usage of every ASMInstr, in order */
+static const Usage USAGES[] = {
+	{ false, true, true, 0, 0, false }, // MOV
+	{ false, true, true, 0, 0, false }, // MOVZX
+	{ false, false, false, 0, 0, true }, // PUSH
+	{ false, false, false, 0, 0, true }, // POP
+	{ true, true, true, 0, 0, false }, // ADD
+	{ true, true, true, 0, 0, false }, // SUB
+	{ true, true, true, 0, 0, false }, // IMUL
+	{ true, true, true, EAX_BIT | EDX_BIT, EAX_BIT | EDX_BIT, false }, // IDIV
+	{ true, true, true, 0, 0, false }, // AND
+	{ true, true, true, 0, 0, false }, // OR
+	{ true, true, false, 0, 0, false }, // NEG
+	{ true, true, false, 0, 0, false }, // NOT
+	{ true, false, true, 0, 0, false }, // CMP
+	{ false, false, false, 0, 0, true }, // JMP
+	{ false, false, false, 0, 0, true }, // JZ
+	{ false, false, false, 0, 0, true }, // JNZ
+	{ false, false, false, 0, 0, true }, // JE
+	{ false, false, false, 0, 0, true }, // JNE
+	{ false, false, false, 0, 0, true }, // JG
+	{ false, false, false, 0, 0, true }, // JGE
+	{ false, false, false, 0, 0, true }, // JL
+	{ false, false, false, 0, 0, true }, // JLE
+	{ false, false, false, 0, 0, true }, // LOOP
+	{ false, false, false, 0, 0, true }, // CALL
+	{ false, false, false, 0, 0, true }, // RET
+	{ false, false, false, 0, 0, true }, // LABEL
+	{ false, false, false, 0, 0, false }, // COMMENT
+	{ false, false, false, 0, 0, false }, // SPACE
+	{ false, false, false, 0, 0, true }, // DIRECTIVE
+};
+
+static_assert(sizeof(USAGES) / sizeof(Usage) == (size_t) ASMInstr::DIRECTIVE + 1, "Every ASMInstr needs a Usage");
+
+/**
+* @return the registers given operand addresses: itself if it's a register, or ebp if it's in memory.
+*/
+static unsigned OperandBits(const ASMOperand &operand)
+{
+	if (operand.kind == ASMOperand::REG)
+	{
+		return REG_BITS[(size_t) operand.reg];
+	}
+
+	return operand.kind == ASMOperand::MEM ? EBP_BIT : 0;
+}
+
+static Effects GetEffects(const ASMInstruction &instruction)
+{
+	const Usage &usage = USAGES[(size_t) instruction.instr];
+	Effects effects{ usage.reads, usage.writes, false, false, usage.barrier };
+
+	if (usage.readsSrc)
+	{
+		effects.reads |= OperandBits(instruction.src);
+		effects.readsMemory = instruction.src.kind == ASMOperand::MEM;
+	}
+
+	if (usage.readsDst || usage.writesDst)
+	{
+		bool memory = instruction.dst.kind == ASMOperand::MEM;
+		unsigned bits = OperandBits(instruction.dst);
+
+		/* Writing to memory reads the register it's addressed by */
+		effects.reads |= usage.readsDst || memory ? bits : 0;
+		effects.writes |= usage.writesDst && !memory ? bits : 0;
+		effects.readsMemory |= usage.readsDst && memory;
+		effects.writesMemory = usage.writesDst && memory;
+	}
+
+	/* Moving the stack, or the frame that variables are addressed by, changes what PUSH, POP & memory operands mean */
+	effects.barrier |= (effects.writes & (EBP_BIT | ESP_BIT)) != 0;
+
+	return effects;
+}
+
+/**
+* Removes an instruction from the code, keeping an inline label before it on a line of its own if it'd share it with something that isn't an instruction.
+*/
+static void Erase(std::vector<ASMInstruction> &code, size_t &end, size_t index)
+{
+	for (size_t i = index + 1; i < end; i++)
+	{
+		code[i - 1] = code[i];
+	}
+
+	end--;
+
+	if (index > 0 && code[index - 1].instr == ASMInstr::LABEL && index < end && !Executes(code[index]))
+	{
+		code[index - 1].flags &= ~ASMInstruction::INLINE;
+	}
+}
+
+/**
+* PUSH x ... POP y, where the instructions in between don't use the stack.
+* The value is moved directly instead: at the PUSH if nothing in between uses y, otherwise at the POP if nothing in between changes x.
+*/
+static size_t PushPop(std::vector<ASMInstruction> &code, size_t &end)
+{
+	size_t popIndex = end - 1;
+	ASMInstruction pop = code[popIndex];
+
+	if (pop.instr != ASMInstr::POP)
+	{
+		return 0;
+	}
+
+	Effects between{ 0, 0, false, false, false };
+	size_t distance = 0;
+	size_t i = popIndex;
+
+	while (i-- > 0)
+	{
+		if (code[i].instr == ASMInstr::PUSH)
+		{
+			break;
+		}
+
+		Effects effects = GetEffects(code[i]);
+
+		if (effects.barrier || ++distance > MAX_DISTANCE)
+		{
+			return 0;
+		}
+
+		between.reads |= effects.reads;
+		between.writes |= effects.writes;
+		between.readsMemory |= effects.readsMemory;
+		between.writesMemory |= effects.writesMemory;
+	}
+
+	if (i == SIZE_MAX)
+	{
+		return 0;
+	}
+
+	const ASMOperand x = code[i].dst;
+	const ASMOperand y = pop.dst;
+
+	/* Only whole registers & DWORDs can be pushed, and x86 can't move from memory to memory */
+	if ((x.kind == ASMOperand::REG && !IsFullReg(x)) || (x.kind == ASMOperand::MEM && (x.size != ASMSize::DWORD || y.kind == ASMOperand::MEM)) || (y.kind != ASMOperand::MEM && !IsFullReg(y)))
+	{
+		return 0;
+	}
+
+	bool xChanged = (x.kind == ASMOperand::REG && (between.writes & REG_BITS[(size_t) x.reg])) || (x.kind == ASMOperand::MEM && between.writesMemory);
+	bool yUsed = y.kind == ASMOperand::REG ? ((between.reads | between.writes) & REG_BITS[(size_t) y.reg]) != 0 : between.readsMemory || between.writesMemory;
+
+	if (SameOperand(x, y) && !xChanged)
+	{
+		Erase(code, end, popIndex);
+		Erase(code, end, i);
+		return 2;
+	}
+
+	ASMInstruction move{ ASMInstr::MOV, 0, y, x, code[i].comment != ASMInstruction::NO_COMMENT ? code[i].comment : pop.comment };
+
+	if (!yUsed)
+	{
+		code[i] = move;
+		Erase(code, end, popIndex);
+		return 1;
+	}
+
+	if (!xChanged)
+	{
+		code[popIndex] = move;
+		Erase(code, end, i);
+		return 1;
+	}
+
+	return 0;
+}
+
+/**
+* MOV r, r; or MOV r, x followed by an instruction that overwrites r without reading it.
+*/
+static size_t DeadMove(std::vector<ASMInstruction> &code, size_t &end)
+{
+	const ASMInstruction &last = code[end - 1];
+
+	if (last.instr == ASMInstr::MOV && last.dst.kind == ASMOperand::REG && SameOperand(last.dst, last.src))
+	{
+		Erase(code, end, end - 1);
+		return 1;
+	}
+
+	if (!Executes(last) || !IsFullReg(last.dst))
+	{
+		return 0;
+	}
+
+	Effects effects = GetEffects(last);
+	unsigned reg = REG_BITS[(size_t) last.dst.reg];
+
+	/* POP is a barrier only for moving code across it; it still overwrites its register */
+	bool overwrites = last.instr == ASMInstr::POP || last.instr == ASMInstr::MOV || last.instr == ASMInstr::MOVZX;
+
+	if (!overwrites || (effects.reads & reg))
+	{
+		return 0;
+	}
+
+	size_t i = end - 1;
+
+	while (i-- > 0 && !Executes(code[i]) && code[i].instr != ASMInstr::LABEL && code[i].instr != ASMInstr::DIRECTIVE)
+	{
+	}
+
+	if (i == SIZE_MAX)
+	{
+		return 0;
+	}
+
+	const ASMInstruction &previous = code[i];
+
+	if ((previous.instr == ASMInstr::MOV || previous.instr == ASMInstr::MOVZX) && IsFullReg(previous.dst) && previous.dst.reg == last.dst.reg)
+	{
+		Erase(code, end, i);
+		return 1;
+	}
+
+	return 0;
+}
+
+/**
+* A jump to a label that's defined right after it, possibly among other labels.
+*/
+static size_t JumpToNext(std::vector<ASMInstruction> &code, size_t &end)
+{
+	const ASMInstruction &last = code[end - 1];
+
+	if (last.instr != ASMInstr::LABEL)
+	{
+		return 0;
+	}
+
+	size_t i = end - 1;
+
+	while (i-- > 0 && (code[i].instr == ASMInstr::LABEL || code[i].instr == ASMInstr::COMMENT || code[i].instr == ASMInstr::SPACE))
+	{
+	}
+
+	if (i == SIZE_MAX || !IsJump(code[i].instr) || code[i].dst.value != last.dst.value)
+	{
+		return 0;
+	}
+
+	Erase(code, end, i);
+	return 1;
+}
+
+/* A set of ASMInstrs, as bits */
+static constexpr uint32_t Instrs(ASMInstr instr)
+{
+	return 1u << (unsigned) instr;
+}
+
+struct PeepholeRuleEntry
+{
+	PeepholeRule rule;
+	const char *name;
+	/* The instructions that the end of the code must be for the rule to apply */
+	uint32_t triggers;
+	/* Applies the rule to the end of the code, returning how many instructions it removed (0 if it doesn't apply) */
+	size_t (*apply)(std::vector<ASMInstruction> &code, size_t &end);
+};
+
+static const PeepholeRuleEntry RULES[PEEPHOLE_RULE_COUNT] = {
+	{ PeepholeRule::PUSH_POP, "push_pop", Instrs(ASMInstr::POP), PushPop },
+	{ PeepholeRule::DEAD_MOVE, "dead_move", Instrs(ASMInstr::MOV) | Instrs(ASMInstr::MOVZX) | Instrs(ASMInstr::POP), DeadMove },
+	{ PeepholeRule::JUMP_TO_NEXT, "jump_to_next", Instrs(ASMInstr::LABEL), JumpToNext },
+};
+
+/* Instructions that some rule applies to */
+static const uint32_t TRIGGERS = RULES[0].triggers | RULES[1].triggers | RULES[2].triggers;
+
+const char *PeepholeRuleName(PeepholeRule rule)
+{
+	return RULES[(size_t) rule].name;
+}
+
+PeepholeStats::PeepholeStats() :
+	instructions(0),
+	applied(),
+	removed()
+{
+}
+
+void PeepholeStats::Add(const PeepholeStats &other)
+{
+	instructions += other.instructions;
+
+	for (size_t i = 0; i < PEEPHOLE_RULE_COUNT; i++)
+	{
+		applied[i] += other.applied[i];
+		removed[i] += other.removed[i];
+	}
+}
+
+void Peephole(std::vector<ASMInstruction> &instructions, PeepholeStats &stats)
+{
+	size_t end = 0;
+
+	for (size_t i = 0; i < instructions.size(); i++)
+	{
+		instructions[end++] = instructions[i];
+
+		if (Executes(instructions[end - 1]))
+		{
+			stats.instructions++;
+		}
+
+		/* Every rule removes instructions, so trying them all again after one applies ends */
+		bool retry = (TRIGGERS & Instrs(instructions[end - 1].instr)) != 0;
+
+		while (retry && end > 0)
+		{
+			retry = false;
+			uint32_t last = Instrs(instructions[end - 1].instr);
+
+			for (size_t r = 0; r < PEEPHOLE_RULE_COUNT && !retry; r++)
+			{
+				size_t removed = (RULES[r].triggers & last) ? RULES[r].apply(instructions, end) : 0;
+
+				if (removed > 0)
+				{
+					stats.applied[r]++;
+					stats.removed[r] += removed;
+					retry = true;
+				}
+			}
+		}
+
+		/* An inline label whose instruction was removed gets a line of its own */
+		if (end >= 2 && instructions[end - 2].instr == ASMInstr::LABEL && !Executes(instructions[end - 1]))
+		{
+			instructions[end - 2].flags &= ~ASMInstruction::INLINE;
+		}
+	}
+
+	instructions.resize(end);
+}
@@ -0,0 +1,43 @@
+#pragma once
+#include <cstddef>
+#include <vector>
+#include "ASMInstruction.h"
+
+/* Rules of the peephole pass, in the order they're tried */
+enum class PeepholeRule
+{
+	/* A PUSH that's popped right after becomes a MOV, or nothing if it's popped to where it came from */
+	PUSH_POP,
+	/* A MOV to a register that's overwritten before it's read (or to itself) is removed */
+	DEAD_MOVE,
+	/* A jump to the label right after it is removed */
+	JUMP_TO_NEXT,
+};
+
+static const size_t PEEPHOLE_RULE_COUNT = 3;
+
+const char *PeepholeRuleName(PeepholeRule rule);
+
+/* How much the peephole pass changed the code */
+struct PeepholeStats
+{
+	/* Instructions given to the pass (not counting lines that don't execute) */
+	size_t instructions;
+	/* By rule: how many times it was applied, and how many instructions it removed */
+	size_t applied[PEEPHOLE_RULE_COUNT];
+	size_t removed[PEEPHOLE_RULE_COUNT];
+
+	PeepholeStats();
+
+	void Add(const PeepholeStats &other);
+};
+
+/**
+* Replaces short sequences of instructions with fewer instructions that do the same, according to a table of rules.
+* The instructions are scanned once; after every instruction, the rules are tried on the end of the code so far, until none applies.
+* A rule only looks a few instructions back, and never moves code across a label, a jump or a change of the stack.
+*
+* @param instructions the code to optimize, in place.
+* @param stats receives what every rule did.
+*/
+void Peephole(std::vector<ASMInstruction> &instructions, PeepholeStats &stats);
@@ -0,0 +1,139 @@
+#include "RegAllocator.h"
+#include "ASMGenerator.h"
+
+const ASMReg RegAllocator::REGS[REG_COUNT] = { ASMReg::EAX, ASMReg::EBX, ASMReg::ECX, ASMReg::EDX };
+
+RegAllocator::RegAllocator(ASMGenerator *asmGen, const unsigned *reserved) :
+	asmGen(asmGen),
+	spilled(0),
+	busy(0),
+	reserved(reserved)
+{
+}
+
+size_t RegAllocator::Count() const
+{
+	return values.size();
+}
+
+void RegAllocator::Spill()
+{
+	ASMReg reg = values[spilled++];
+
+	asmGen->Append(ASMInstr::PUSH, reg, "; spill");
+	busy &= ~Bit(reg);
+}
+
+ASMReg RegAllocator::FreeReg(unsigned avoid) const
+{
+	for (ASMReg reg : REGS)
+	{
+		if (!((busy | avoid | *reserved) & Bit(reg)))
+		{
+			return reg;
+		}
+	}
+
+	return NONE_FREE;
+}
+
+ASMReg RegAllocator::Allocate()
+{
+	if (FreeReg() == NONE_FREE)
+	{
+		Spill();
+	}
+
+	ASMReg reg = FreeReg();
+	Push(reg);
+
+	return reg;
+}
+
+void RegAllocator::Push(ASMReg reg)
+{
+	values.push_back(reg);
+	busy |= Bit(reg);
+}
+
+void RegAllocator::Pop()
+{
+	busy &= ~Bit(values.back());
+	values.pop_back();
+}
+
+void RegAllocator::Store()
+{
+	if (spilled == values.size())
+	{
+		/* Already in the ASM stack */
+		spilled--;
+		values.pop_back();
+		return;
+	}
+
+	asmGen->Append(ASMInstr::PUSH, values.back());
+	Pop();
+}
+
+void RegAllocator::Load(size_t count)
+{
+	/* The newest spilled value is the one at the top of the ASM stack */
+	while (spilled > values.size() - count)
+	{
+		ASMReg reg = FreeReg();
+
+		asmGen->Append(ASMInstr::POP, reg, "; reload");
+		values[--spilled] = reg;
+		busy |= Bit(reg);
+	}
+}
+
+void RegAllocator::SpillBelow(size_t count)
+{
+	while (spilled + count < values.size())
+	{
+		Spill();
+	}
+}
+
+ASMReg RegAllocator::Reg(size_t depth) const
+{
+	return values[values.size() - 1 - depth];
+}
+
+bool RegAllocator::Holds(ASMReg reg) const
+{
+	return (busy & Bit(reg)) != 0;
+}
+
+void RegAllocator::Move(size_t depth, ASMReg to)
+{
+	ASMReg &from = values[values.size() - 1 - depth];
+
+	if (from == to)
+	{
+		return;
+	}
+
+	if (busy & Bit(to))
+	{
+		/* Move the register's value out of the way, keeping it out of the one that's being moved too */
+		for (size_t i = spilled; i < values.size(); i++)
+		{
+			if (values[i] == to)
+			{
+				ASMReg free = FreeReg(Bit(from));
+
+				asmGen->Append(ASMInstr::MOV, free, to);
+				values[i] = free;
+				busy |= Bit(free);
+				break;
+			}
+		}
+	}
+
+	asmGen->Append(ASMInstr::MOV, to, from);
+	busy = (busy & ~Bit(from)) | Bit(to);
+	from = to;
+}
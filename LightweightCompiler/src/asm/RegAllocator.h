@@ -0,0 +1,104 @@
+#pragma once
+#include <cstddef>
+#include <vector>
+#include "ASMInstruction.h"
+
+class ASMGenerator;
+
+/**
+* Holds the values of an expression that's being evaluated, as a stack of values whose newest values are in registers.
+* A new value gets a free register. When there's none, the oldest value that's in a register is pushed to the ASM stack (spilled),
+* and it's popped back to a register when it's used. Spilled values are always the oldest ones, so they're in the ASM stack in the same order.
+*/
+class RegAllocator
+{
+private:
+	static const size_t REG_COUNT = 4;
+	/* Registers that hold values, in the order they're allocated */
+	static const ASMReg REGS[REG_COUNT];
+
+	ASMGenerator *asmGen;
+	/* Register of every value, oldest first. The first `spilled` values are in the ASM stack instead */
+	std::vector<ASMReg> values;
+	size_t spilled;
+	/* Registers that hold values, as bits by ASMReg */
+	unsigned busy;
+	/* Registers that hold something else while the allocator is used, as bits by ASMReg */
+	const unsigned *reserved;
+
+	/**
+	* Pushes the oldest value that's in a register to the ASM stack.
+	*/
+	void Spill();
+
+public:
+	/* Returned by FreeReg when no register is free */
+	static const ASMReg NONE_FREE = ASMReg::ESP;
+
+	/**
+	* @param reserved registers (as bits by ASMReg) that values mustn't use. They may change between evaluations.
+	*/
+	RegAllocator(ASMGenerator *asmGen, const unsigned *reserved);
+
+	/**
+	* @return given register as a bit, for sets of registers.
+	*/
+	static unsigned Bit(ASMReg reg)
+	{
+		return 1u << (unsigned) reg;
+	}
+
+	/**
+	* @return the amount of values.
+	*/
+	size_t Count() const;
+
+	/**
+	* Adds a value, in a free register. Spills a value if there's none.
+	*
+	* @return the value's register, which the caller loads the value to.
+	*/
+	ASMReg Allocate();
+	/**
+	* Adds a value that's in given free register.
+	*/
+	void Push(ASMReg reg);
+	/**
+	* Removes the newest value & frees its register. The value must be in a register (see Load).
+	*/
+	void Pop();
+	/**
+	* Removes the newest value, leaving it in the ASM stack: pushes it if it's in a register.
+	*/
+	void Store();
+
+	/**
+	* Pops the newest values that were spilled back to registers, so the newest given amount of values are in registers.
+	*/
+	void Load(size_t count);
+	/**
+	* Spills every value but the newest given amount, so only those are in registers.
+	*/
+	void SpillBelow(size_t count);
+
+	/**
+	* @param depth how many values were added after the value (0 for the newest).
+	* @return the register of the value, which must be in a register (see Load).
+	*/
+	ASMReg Reg(size_t depth) const;
+	/**
+	* @return whether given register holds one of the values.
+	*/
+	bool Holds(ASMReg reg) const;
+	/**
+	* Moves a value to given register. A value that's already in the register is moved to a free register first, so there must be one.
+	*
+	* @param depth how many values were added after the value (0 for the newest). The value must be in a register (see Load).
+	*/
+	void Move(size_t depth, ASMReg to);
+	/**
+	* @param avoid registers (as bits by ASMReg) that mustn't be returned.
+	* @return a register that holds no value & isn't avoided or reserved, or NONE_FREE if there's none.
+	*/
+	ASMReg FreeReg(unsigned avoid = 0) const;
+};
@@ -0,0 +1,328 @@
+#include "BlockCache.h"
+#include "../util/Hash.h"
+#include <chrono>
+#include <cstring>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <thread>
+#include <type_traits>
+
+static_assert(std::is_trivially_copyable<CachedBlock>::value && std::is_trivially_copyable<CachedDeclaration>::value && std::is_trivially_copyable<CachedBinding>::value,
+	"Cached records are saved & loaded as raw bytes");
+
+/* Start of every saved cache */
+static const char MAGIC[8] = { 'L', 'W', 'B', 'L', 'O', 'C', 'K', 'S' };
+
+/* Fixed-size start of a saved cache, followed by the compiler version, the blocks, declarations, bindings & text */
+struct CacheHeader
+{
+	char magic[sizeof(MAGIC)];
+	/* Sizes of the records, which differ between builds of the compiler (e.g. 32 & 64 bit) */
+	uint32_t blockSize, declarationSize, bindingSize;
+	uint64_t versionLength, blockCount, declarationCount, bindingCount, textLength;
+};
+
+/**
+* Reads given amount of records into given vector (or string).
+*
+* @return whether all records were read.
+*/
+template <typename Records>
+static bool ReadRecords(std::ifstream &file, Records &records, uint64_t count, uint64_t fileSize)
+{
+	/* A corrupt count mustn't allocate more than the file holds */
+	if (count > fileSize / sizeof(records[0]))
+	{
+		return false;
+	}
+
+	records.resize((size_t) count);
+	return (bool) file.read((char *) records.data(), count * sizeof(records[0]));
+}
+
+bool BlockCache::Load(const std::string &path, const std::string &version)
+{
+	blocks.clear();
+	declarations.clear();
+	bindings.clear();
+	text.clear();
+	blocksByHash.clear();
+
+	std::ifstream file(path, std::ios::binary);
+
+	if (!file)
+	{
+		return false;
+	}
+
+	file.seekg(0, std::ios::end);
+	uint64_t fileSize = (uint64_t) file.tellg();
+	file.seekg(0, std::ios::beg);
+
+	CacheHeader header;
+	std::string savedVersion;
+
+	bool intact = file.read((char *) &header, sizeof(header))
+		&& memcmp(header.magic, MAGIC, sizeof(MAGIC)) == 0
+		&& header.blockSize == sizeof(CachedBlock) && header.declarationSize == sizeof(CachedDeclaration) && header.bindingSize == sizeof(CachedBinding)
+		&& header.versionLength == version.length();
+
+	if (intact)
+	{
+		savedVersion.resize(version.length());
+		intact = file.read(&savedVersion[0], savedVersion.length()) && savedVersion == version
+			&& ReadRecords(file, blocks, header.blockCount, fileSize)
+			&& ReadRecords(file, declarations, header.declarationCount, fileSize)
+			&& ReadRecords(file, bindings, header.bindingCount, fileSize)
+			&& ReadRecords(file, text, header.textLength, fileSize);
+	}
+
+	/* Every record must refer to existing records & text */
+	auto validString = [this](CachedString string) { return string.start <= text.length() && string.length <= text.length() - string.start; };
+
+	for (size_t i = 0; intact && i < declarations.size(); i++)
+	{
+		intact = validString(declarations[i].id);
+	}
+
+	for (size_t i = 0; intact && i < bindings.size(); i++)
+	{
+		intact = validString(bindings[i].id);
+	}
+
+	for (size_t i = 0; intact && i < blocks.size(); i++)
+	{
+		const CachedBlock &block = blocks[i];
+
+		intact = validString(block.code)
+			&& block.firstDeclaration <= declarations.size() && block.declarationCount <= declarations.size() - block.firstDeclaration
+			&& block.firstBinding <= bindings.size() && block.bindingCount <= bindings.size() - block.firstBinding
+			&& block.importCount <= block.bindingCount;
+	}
+
+	if (!intact)
+	{
+		blocks.clear();
+		declarations.clear();
+		bindings.clear();
+		text.clear();
+		return false;
+	}
+
+	Index();
+	return true;
+}
+
+bool BlockCache::Save(const std::string &path, const std::string &version) const
+{
+	CacheHeader header{};
+
+	memcpy(header.magic, MAGIC, sizeof(MAGIC));
+	header.blockSize = sizeof(CachedBlock);
+	header.declarationSize = sizeof(CachedDeclaration);
+	header.bindingSize = sizeof(CachedBinding);
+	header.versionLength = version.length();
+	header.blockCount = blocks.size();
+	header.declarationCount = declarations.size();
+	header.bindingCount = bindings.size();
+	header.textLength = text.length();
+
+	/* Write a temporary file that's unique between threads & processes, then rename it over the saved cache */
+	uint64_t unique = HashBytes(std::to_string(std::chrono::steady_clock::now().time_since_epoch().count()), std::hash<std::thread::id>()(std::this_thread::get_id()));
+	std::string tempPath = path + ".tmp-" + HashToHex(unique);
+
+	{
+		std::ofstream file(tempPath, std::ios::binary);
+
+		file.write((const char *) &header, sizeof(header));
+		file.write(version.data(), version.length());
+		file.write((const char *) blocks.data(), blocks.size() * sizeof(CachedBlock));
+		file.write((const char *) declarations.data(), declarations.size() * sizeof(CachedDeclaration));
+		file.write((const char *) bindings.data(), bindings.size() * sizeof(CachedBinding));
+		file.write(text.data(), text.length());
+
+		if (!file)
+		{
+			file.close();
+			remove(tempPath.c_str());
+			return false;
+		}
+	}
+
+	std::error_code error;
+	std::filesystem::rename(tempPath, path, error);
+
+	if (error)
+	{
+		remove(tempPath.c_str());
+		return false;
+	}
+
+	return true;
+}
+
+CachedString BlockCache::AddText(std::string_view string)
+{
+	CachedString added{ text.length(), string.length() };
+	text += string;
+
+	return added;
+}
+
+void BlockCache::Index()
+{
+	blocksByHash.clear();
+	blocksByHash.reserve(blocks.size());
+
+	for (size_t i = 0; i < blocks.size(); i++)
+	{
+		blocksByHash.emplace(blocks[i].tokenHash, i);
+	}
+}
+
+void BlockCache::Add(const CompiledBlock &block)
+{
+	auto range = blocksByHash.equal_range(block.tokenHash);
+
+	for (auto it = range.first; it != range.second; it++)
+	{
+		const CachedBlock &cached = blocks[it->second];
+		const CachedBinding *cachedBindings = Bindings(cached);
+
+		bool identical = cached.importCount == block.importCount && cached.bindingCount == block.bindings.size();
+
+		for (size_t i = 0; identical && i < block.bindings.size(); i++)
+		{
+			identical = Text(cachedBindings[i].id) == block.bindings[i].id && cachedBindings[i].type == block.bindings[i].type;
+		}
+
+		if (identical)
+		{
+			return;
+		}
+	}
+
+	size_t firstDeclaration = declarations.size();
+	size_t firstBinding = bindings.size();
+
+	for (const CompiledDeclaration &declaration : block.declarations)
+	{
+		declarations.push_back(CachedDeclaration{ AddText(declaration.id), declaration.type, declaration.offset });
+	}
+
+	for (const CompiledBinding &binding : block.bindings)
+	{
+		bindings.push_back(CachedBinding{ AddText(binding.id), binding.type });
+	}
+
+	/* The code follows the block's names in the text */
+	CachedBlock cached{ block.tokenHash, firstDeclaration, block.declarations.size(), firstBinding, block.bindings.size(), block.importCount,
+		CachedString{ text.length(), block.code.Size() }, block.labelCount, block.stackBytes };
+
+	for (size_t page = 0; page < block.code.PageCount(); page++)
+	{
+		text += block.code.PageAt(page);
+	}
+
+	blocksByHash.emplace(cached.tokenHash, blocks.size());
+	blocks.push_back(cached);
+}
+
+void BlockCache::Retain(const std::vector<const CachedBlock *> &kept)
+{
+	std::vector<CachedBlock> retainedBlocks;
+	std::vector<CachedDeclaration> retainedDeclarations;
+	std::vector<CachedBinding> retainedBindings;
+	std::vector<bool> taken(blocks.size());
+	size_t textLength = 0;
+
+	for (const CachedBlock *block : kept)
+	{
+		if (block == NULL || taken[block - blocks.data()])
+		{
+			continue;
+		}
+
+		taken[block - blocks.data()] = true;
+
+		CachedBlock retained = *block;
+		retained.firstDeclaration = retainedDeclarations.size();
+		retained.firstBinding = retainedBindings.size();
+
+		retainedDeclarations.insert(retainedDeclarations.end(), Declarations(*block), Declarations(*block) + block->declarationCount);
+		retainedBindings.insert(retainedBindings.end(), Bindings(*block), Bindings(*block) + block->bindingCount);
+		retainedBlocks.push_back(retained);
+
+		textLength += block->code.length;
+	}
+
+	blocks = std::move(retainedBlocks);
+	declarations = std::move(retainedDeclarations);
+	bindings = std::move(retainedBindings);
+
+	/* Once the removed blocks' code takes most of the text, the kept strings are moved to a new text */
+	if (textLength < text.length() / 2)
+	{
+		std::string retainedText;
+		retainedText.swap(text);
+
+		for (CachedBlock &block : blocks)
+		{
+			block.code = AddText(std::string_view(retainedText).substr(block.code.start, block.code.length));
+		}
+
+		for (CachedDeclaration &declaration : declarations)
+		{
+			declaration.id = AddText(std::string_view(retainedText).substr(declaration.id.start, declaration.id.length));
+		}
+
+		for (CachedBinding &binding : bindings)
+		{
+			binding.id = AddText(std::string_view(retainedText).substr(binding.id.start, binding.id.length));
+		}
+	}
+
+	Index();
+}
+
+const CachedBlock *BlockCache::Find(uint64_t tokenHash, const CachedBlock *after) const
+{
+	auto range = blocksByHash.equal_range(tokenHash);
+
+	for (auto it = range.first; it != range.second; it++)
+	{
+		if (after == NULL)
+		{
+			return &blocks[it->second];
+		}
+
+		/* Found the previous block; the next one is returned */
+		if (&blocks[it->second] == after)
+		{
+			after = NULL;
+		}
+	}
+
+	return NULL;
+}
+
+const CachedDeclaration *BlockCache::Declarations(const CachedBlock &block) const
+{
+	return declarations.data() + block.firstDeclaration;
+}
+
+const CachedBinding *BlockCache::Bindings(const CachedBlock &block) const
+{
+	return bindings.data() + block.firstBinding;
+}
+
+std::string_view BlockCache::Text(CachedString string) const
+{
+	return std::string_view(text).substr(string.start, string.length);
+}
+
+size_t BlockCache::Size() const
+{
+	return blocks.size();
+}
@@ -0,0 +1,157 @@
+#pragma once
+#include "../tokens/Token.h"
+#include "../util/CodeBuffer.h"
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+/* A string in a BlockCache's text */
+struct CachedString
+{
+	size_t start, length;
+};
+
+/* A top-level variable declared by a cached block */
+struct CachedDeclaration
+{
+	CachedString id;
+	/* The declared type's TokenType */
+	TokenType type;
+	/* Offset of the variable, relative to the block's stack bytes */
+	size_t offset;
+};
+
+/* A top-level name a cached block looked up outside of itself, and what it was bound to */
+struct CachedBinding
+{
+	CachedString id;
+	/* The declared type's TokenType of the variable the name was bound to, or INVALID if no earlier block declared it */
+	TokenType type;
+};
+
+/**
+* Everything compiled from a top-level block (a top-level statement & the blank lines after it) that's needed to reuse its code in a later compilation.
+* Together, the hash of the block's Tokens & its bindings fingerprint the block: a block with the same Tokens, whose names are bound the same way, compiles to the same code.
+*/
+struct CachedBlock
+{
+	/* Hash of the block's Tokens (types & literals) */
+	uint64_t tokenHash;
+	/* The block's top-level declarations in declaration order, in the cache's declarations */
+	size_t firstDeclaration, declarationCount;
+	/* The block's imports in import order followed by the names it found no declaration for, in the cache's bindings */
+	size_t firstBinding, bindingCount;
+	/* The amount of imports at the start of the block's bindings. The block's code refers to imported variables by their position */
+	size_t importCount;
+	/* Relocatable code of the block */
+	CachedString code;
+	size_t labelCount, stackBytes;
+};
+
+/* A top-level variable declared by a compiled block, before the block is cached */
+struct CompiledDeclaration
+{
+	std::string id;
+	TokenType type;
+	size_t offset;
+};
+
+/* A top-level name a compiled block looked up outside of itself, before the block is cached */
+struct CompiledBinding
+{
+	std::string id;
+	TokenType type;
+};
+
+/* A compiled block, before it's cached. See CachedBlock */
+struct CompiledBlock
+{
+	uint64_t tokenHash;
+	std::vector<CompiledDeclaration> declarations;
+	std::vector<CompiledBinding> bindings;
+	size_t importCount;
+	CodeBuffer code;
+	size_t labelCount, stackBytes;
+};
+
+/**
+* Blocks of a program's last compilation, persisted between compilations so blocks that didn't change aren't compiled again.
+* The blocks are stored flat: fixed-size records that refer to shared arrays of declarations & bindings, and to a single text that holds all strings.
+* Saving & loading only writes & reads these arrays as they are.
+*/
+class BlockCache
+{
+private:
+	std::vector<CachedBlock> blocks;
+	std::vector<CachedDeclaration> declarations;
+	std::vector<CachedBinding> bindings;
+	/* Code & names of all blocks, one after the other. Retain leaves the strings of removed blocks in place until they take most of it */
+	std::string text;
+	/* Positions of the blocks in blocks, by their Tokens' hash */
+	std::unordered_multimap<uint64_t, size_t> blocksByHash;
+
+	/**
+	* Appends given string to the text.
+	*
+	* @return where the string was placed.
+	*/
+	CachedString AddText(std::string_view string);
+	/**
+	* Rebuilds blocksByHash from blocks.
+	*/
+	void Index();
+
+public:
+	/**
+	* Replaces the cached blocks with the ones saved in given file.
+	*
+	* @param version the compiler version the blocks must have been compiled by.
+	* @return whether the file exists, was saved by given compiler version & is intact. Otherwise, the cache is left empty.
+	*/
+	bool Load(const std::string &path, const std::string &version);
+	/**
+	* Saves the cached blocks into given file. The file is replaced at once, so a concurrent Load reads either the old blocks or the new ones.
+	*
+	* @return whether the file was saved.
+	*/
+	bool Save(const std::string &path, const std::string &version) const;
+
+	/**
+	* Caches given block, unless an identical block (same Tokens & bindings) is already cached.
+	* Views into the text (see Text) are invalidated.
+	*/
+	void Add(const CompiledBlock &block);
+	/**
+	* Removes every cached block but the given ones. Pointers to blocks & views into the text are invalidated.
+	*
+	* @param kept blocks of this cache. May hold the same block more than once, and NULLs, which are ignored.
+	*/
+	void Retain(const std::vector<const CachedBlock *> &kept);
+	/**
+	* Iterates the cached blocks with given Tokens' hash.
+	*
+	* @param after the previously found block, or NULL to find the first one.
+	* @return the next cached block with given Tokens' hash, or NULL if there are no more.
+	*/
+	const CachedBlock *Find(uint64_t tokenHash, const CachedBlock *after = NULL) const;
+
+	/**
+	* @return the first of given block's declarations. The block has declarationCount of them.
+	*/
+	const CachedDeclaration *Declarations(const CachedBlock &block) const;
+	/**
+	* @return the first of given block's bindings. The block has bindingCount of them.
+	*/
+	const CachedBinding *Bindings(const CachedBlock &block) const;
+	/**
+	* @return view of given string, valid until a block is added.
+	*/
+	std::string_view Text(CachedString string) const;
+
+	/**
+	* @return the amount of cached blocks.
+	*/
+	size_t Size() const;
+};
@@ -0,0 +1,173 @@
+#include "BuildCache.h"
+#include "../util/Hash.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+namespace fs = std::filesystem;
+
+const uintmax_t BuildCache::DEFAULT_MAX_BYTES = 256 * 1024 * 1024;
+
+/* Prefix of temporary directories (entries being stored or removed). Entry names are hex digits only, so they never start with it */
+static const char TEMP_PREFIX[] = "tmp-";
+/* Temporary directories that weren't touched for this long were left behind by a build that crashed */
+static const std::chrono::hours TEMP_LIFETIME(1);
+
+BuildCache::BuildCache(const fs::path &directory, uintmax_t maxBytes) :
+	directory(directory),
+	maxBytes(maxBytes)
+{
+	std::error_code error;
+	fs::create_directories(directory, error);
+}
+
+std::string BuildCache::Key(std::string_view source, const std::vector<std::string> &options)
+{
+	uint64_t hash = HashBytes(source);
+
+	for (const std::string &option : options)
+	{
+		/* Chain every option into the hash, with its length so options can't run into each other */
+		hash = HashBytes(option, hash + option.length());
+	}
+
+	return HashToHex(hash);
+}
+
+fs::path BuildCache::TempPath() const
+{
+	/* Unique between threads (counter) & between processes (thread id & time) */
+	static std::atomic<uint64_t> counter(0);
+
+	uint64_t unique = counter++;
+	unique = HashBytes(std::string_view((const char *) &unique, sizeof(unique)), std::hash<std::thread::id>()(std::this_thread::get_id()));
+	unique = HashBytes(std::to_string(std::chrono::steady_clock::now().time_since_epoch().count()), unique);
+
+	return directory / (TEMP_PREFIX + HashToHex(unique));
+}
+
+void BuildCache::Remove(const fs::path &entry) const
+{
+	std::error_code error;
+	fs::path removed = TempPath();
+
+	/* Whoever renames the entry away first removes it */
+	fs::rename(entry, removed, error);
+
+	if (!error)
+	{
+		fs::remove_all(removed, error);
+	}
+}
+
+bool BuildCache::Restore(const std::string &key, const std::vector<fs::path> &files) const
+{
+	std::error_code error;
+	fs::path entry = directory / key;
+
+	for (size_t i = 0; i < files.size(); i++)
+	{
+		fs::copy_file(entry / std::to_string(i), files[i], fs::copy_options::overwrite_existing, error);
+
+		if (error)
+		{
+			return false;
+		}
+	}
+
+	/* The entry's modification time is its last use */
+	fs::last_write_time(entry, fs::file_time_type::clock::now(), error);
+
+	return true;
+}
+
+void BuildCache::Store(const std::string &key, const std::vector<fs::path> &files) const
+{
+	std::error_code error;
+	fs::path temp = TempPath();
+
+	fs::create_directory(temp, error);
+
+	for (size_t i = 0; i < files.size() && !error; i++)
+	{
+		fs::copy_file(files[i], temp / std::to_string(i), error);
+	}
+
+	/* Publish the complete entry at once. If another build published it first, its entry is kept */
+	if (!error)
+	{
+		fs::rename(temp, directory / key, error);
+	}
+
+	if (error)
+	{
+		fs::remove_all(temp, error);
+		return;
+	}
+
+	Evict();
+}
+
+void BuildCache::Evict() const
+{
+	struct Entry
+	{
+		fs::path path;
+		fs::file_time_type lastUse;
+		uintmax_t bytes;
+	};
+
+	std::vector<Entry> entries;
+	uintmax_t totalBytes = 0;
+	std::error_code error;
+
+	for (fs::directory_iterator it(directory, error), end; !error && it != end; it.increment(error))
+	{
+		if (it->path().filename().string().rfind(TEMP_PREFIX, 0) == 0)
+		{
+			if (fs::last_write_time(it->path(), error) + TEMP_LIFETIME < fs::file_time_type::clock::now())
+			{
+				fs::remove_all(it->path(), error);
+			}
+
+			error.clear();
+			continue;
+		}
+
+		Entry entry{ it->path(), fs::last_write_time(it->path(), error), 0 };
+
+		for (fs::directory_iterator file(entry.path, error); !error && file != end; file.increment(error))
+		{
+			entry.bytes += file->file_size(error);
+		}
+
+		/* Entries that are removed meanwhile are skipped */
+		if (error)
+		{
+			error.clear();
+			continue;
+		}
+
+		totalBytes += entry.bytes;
+		entries.push_back(entry);
+	}
+
+	if (totalBytes <= maxBytes)
+	{
+		return;
+	}
+
+	std::sort(entries.begin(), entries.end(), [](const Entry &a, const Entry &b) { return a.lastUse < b.lastUse; });
+
+	for (const Entry &entry : entries)
+	{
+		if (totalBytes <= maxBytes)
+		{
+			break;
+		}
+
+		Remove(entry.path);
+		totalBytes -= entry.bytes;
+	}
+}
@@ -0,0 +1,68 @@
+#pragma once
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+* On-disk cache of built projects, addressed by the content they were built from.
+* An entry holds every file built from a source (ASM, OBJ, EXE), in a directory named after the hash of the source, the compiler version & the build options.
+* Entries are published by renaming a complete temporary directory, and removed by renaming them away first,
+* so any amount of builds (in any amount of processes) can share a cache: a reader either finds a complete entry or none.
+* When the entries grow past the size limit, the least recently used ones are removed.
+* The cache is best effort; a file system error is treated as a miss & never fails the build.
+*/
+class BuildCache
+{
+private:
+	std::filesystem::path directory;
+	/* Total size of the entries that's kept after storing an entry */
+	uintmax_t maxBytes;
+
+	/**
+	* @return a new, unique path for a temporary directory inside the cache.
+	*/
+	std::filesystem::path TempPath() const;
+	/**
+	* Removes given entry, without ever exposing a partially removed entry.
+	*/
+	void Remove(const std::filesystem::path &entry) const;
+	/**
+	* Removes the least recently used entries until the rest fit in maxBytes.
+	*/
+	void Evict() const;
+
+public:
+	/* Size limit of a cache that's constructed without one */
+	static const uintmax_t DEFAULT_MAX_BYTES;
+
+	/**
+	* @param directory where the entries are stored. Created if it doesn't exist.
+	* @param maxBytes the size limit of all entries together.
+	*/
+	BuildCache(const std::filesystem::path &directory, uintmax_t maxBytes = DEFAULT_MAX_BYTES);
+
+	/**
+	* @param source the source code.
+	* @param options everything else that affects the built files (compiler version, build tools & their options).
+	* @return the key of the entry built from given source with given options.
+	*/
+	static std::string Key(std::string_view source, const std::vector<std::string> &options);
+
+	/**
+	* Copies the files of given entry to given paths, and marks the entry as recently used.
+	*
+	* @param key the entry's key.
+	* @param files the paths that receive the entry's files, in the order they were stored.
+	* @return whether the entry exists & all of its files were copied.
+	*/
+	bool Restore(const std::string &key, const std::vector<std::filesystem::path> &files) const;
+	/**
+	* Stores copies of given files as given entry. Nothing is stored if any of the files can't be copied.
+	*
+	* @param key the entry's key.
+	* @param files the built files, in the order they're restored.
+	*/
+	void Store(const std::string &key, const std::vector<std::filesystem::path> &files) const;
+};
@@ -0,0 +1,36 @@
+#pragma once
+#include "../asm/ASMGenerator.h"
+#include "../util/Arena.h"
+
+/**
+* State of a single compilation (or of a single chunk of a parallel compilation), shared by all of its Visitors.
+* Nothing in it is shared with other compilations, so any amount of compilations can run at the same time without locks.
+*/
+struct CompileContext
+{
+	/* Owns the compilation's visitor state */
+	Arena &arena;
+	/* Receives the compilation's code */
+	ASMGenerator asmGen;
+	/* Frame layout: stack bytes allocated for variables so far */
+	size_t stackBytes;
+	/* Registers that hold variables of the loops being compiled (see Var::reg), as bits by ASMReg. Expressions mustn't use them */
+	unsigned loopRegs;
+	/* The variable that each of loopRegs holds, by ASMReg */
+	Var *loopVars[ASM_REG_COUNT];
+
+	/**
+	* @param relocatable whether the code is a part of a program that's joined with other parts later (see ASMGenerator).
+	*/
+	CompileContext(Arena &arena, bool relocatable = false) :
+		arena(arena),
+		asmGen(relocatable),
+		stackBytes(0),
+		loopRegs(0),
+		loopVars()
+	{
+	}
+
+	CompileContext(const CompileContext &) = delete;
+	CompileContext &operator=(const CompileContext &) = delete;
+};
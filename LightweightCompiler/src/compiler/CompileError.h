@@ -0,0 +1,15 @@
+#pragma once
+#include <stdexcept>
+#include <string>
+
+/**
+* Error in a compiled program. Stops the compilation that threw it, without affecting any other compilation in the process.
+*/
+class CompileError : public std::runtime_error
+{
+public:
+	CompileError(const std::string &message) :
+		std::runtime_error(message)
+	{
+	}
+};
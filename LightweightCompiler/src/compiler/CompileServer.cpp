@@ -0,0 +1,236 @@
+#include "CompileServer.h"
+#include "Compiler.h"
+#include "../parser/Parser.h"
+#include "../tokens/Tokenizer.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <exception>
+#include <limits>
+#include <stdexcept>
+
+/* Most programs in a batch, and longest program, that a batch may hold. Larger ones are skipped instead of allocated */
+static const size_t MAX_BATCH_PROGRAMS = 4096;
+static const size_t MAX_PROGRAM_BYTES = 256 * 1024 * 1024;
+
+/**
+* Reads an unsigned decimal number. Stream extraction into an unsigned type would accept a sign & wrap negative numbers around.
+*
+* @param value receives the number, if it's read & fits in a std::streamsize, so that many bytes can be read or skipped.
+* @return whether the number was read.
+*/
+static bool ReadSize(std::istream &input, size_t &value)
+{
+	std::string digits;
+
+	if (!(input >> digits) || digits.find_first_not_of("0123456789") != std::string::npos)
+	{
+		return false;
+	}
+
+	try
+	{
+		unsigned long long number = std::stoull(digits);
+
+		if (number > (unsigned long long) std::numeric_limits<std::streamsize>::max())
+		{
+			return false;
+		}
+
+		value = (size_t) number;
+		return true;
+	}
+	catch (const std::out_of_range &)
+	{
+		return false;
+	}
+}
+
+/**
+* Writes an ERROR frame with given message.
+*/
+static void WriteError(std::ostream &output, const std::string &message)
+{
+	output << "ERROR " << message.length() << '\n' << message << std::flush;
+}
+
+CompileServer::CompileServer(size_t workerCount) :
+	pool(workerCount),
+	slots(pool.WorkerCount())
+{
+}
+
+void CompileServer::CompileRequest(Slot &slot, const std::string &source, Result &result, ThreadPool *pool)
+{
+	auto start = std::chrono::steady_clock::now();
+
+	try
+	{
+		/* Tokens view into source, which outlives the request */
+		Tokenizer tokenizer(source);
+		TokenBuffer tokens(tokenizer.ScanTokens());
+
+		slot.ast.Clear();
+		ParseExprs(tokens, slot.ast, pool);
+
+		result.output = Compile(slot.ast, tokens, slot.arena, pool);
+		result.ok = true;
+	}
+	catch (const std::exception &error)
+	{
+		/* The program is rejected, but the server keeps going */
+		result.output.Clear();
+		result.output.Append(error.what());
+		result.ok = false;
+	}
+
+	slot.arena.Reset();
+
+	auto end = std::chrono::steady_clock::now();
+	result.latency = std::chrono::duration<double, std::micro>(end - start).count();
+}
+
+void CompileServer::CompileBatch(const std::vector<std::string> &sources, std::vector<Result> &results)
+{
+	results.resize(sources.size());
+
+	if (sources.size() == 1)
+	{
+		CompileRequest(slots[0], sources[0], results[0], &pool);
+		return;
+	}
+
+	/* Every worker takes the next program that wasn't taken yet. Programs are compiled serially, as a task can't wait for the pool it runs on */
+	std::atomic<size_t> next(0);
+
+	for (Slot &slot : slots)
+	{
+		pool.Submit([this, &slot, &sources, &results, &next]
+		{
+			for (size_t i = next++; i < sources.size(); i = next++)
+			{
+				CompileRequest(slot, sources[i], results[i], NULL);
+			}
+		});
+	}
+
+	pool.Wait();
+}
+
+void CompileServer::ReportLatency(std::vector<double> samples, const std::string &label, std::ostream &log)
+{
+	if (samples.empty())
+	{
+		return;
+	}
+
+	/* Nearest-rank percentiles: the smallest sample that at least the given share of samples doesn't exceed */
+	size_t p50 = (samples.size() * 50 + 99) / 100 - 1;
+	size_t p99 = (samples.size() * 99 + 99) / 100 - 1;
+
+	std::nth_element(samples.begin(), samples.begin() + p50, samples.end());
+	double p50Value = samples[p50];
+	std::nth_element(samples.begin(), samples.begin() + p99, samples.end());
+	double p99Value = samples[p99];
+
+	log << label << ": " << samples.size() << " programs, p50 " << p50Value << "us, p99 " << p99Value << "us\n";
+}
+
+void CompileServer::Serve(std::istream &input, std::ostream &output, std::ostream &log)
+{
+	std::string command;
+	size_t count;
+
+	std::vector<std::string> sources;
+	std::vector<Result> results;
+	/* Whether a malformed request was answered, and lines are skipped up to the next batch */
+	bool skipping = false;
+
+	while (input >> command)
+	{
+		if (command != "BATCH" || !ReadSize(input, count))
+		{
+			if (!skipping)
+			{
+				WriteError(output, "Malformed request.");
+				skipping = true;
+			}
+
+			input.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+			continue;
+		}
+
+		skipping = false;
+
+		/* Read every program of the batch before compiling any of them. A batch over the limits is still read, but its programs are skipped */
+		bool tooLarge = count > MAX_BATCH_PROGRAMS;
+		bool complete = true;
+
+		sources.resize(tooLarge ? 0 : count);
+
+		for (size_t i = 0; i < count; i++)
+		{
+			size_t length;
+
+			if (!ReadSize(input, length) || input.get() != '\n')
+			{
+				complete = false;
+				break;
+			}
+
+			tooLarge = tooLarge || length > MAX_PROGRAM_BYTES;
+
+			if (tooLarge)
+			{
+				if ((size_t) input.ignore(length).gcount() != length)
+				{
+					complete = false;
+					break;
+				}
+
+				continue;
+			}
+
+			sources[i].resize(length);
+			if (!input.read(&sources[i][0], length))
+			{
+				complete = false;
+				break;
+			}
+		}
+
+		/* A batch the input ended in ends the session, while the rest of a malformed one is skipped */
+		if (!complete)
+		{
+			WriteError(output, input.eof() ? "Incomplete batch." : "Malformed batch.");
+			skipping = true;
+
+			input.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+			continue;
+		}
+
+		if (tooLarge)
+		{
+			WriteError(output, "Batch too large: at most " + std::to_string(MAX_BATCH_PROGRAMS) + " programs of at most " + std::to_string(MAX_PROGRAM_BYTES) + " bytes.");
+			continue;
+		}
+
+		CompileBatch(sources, results);
+
+		std::vector<double> batchLatencies;
+
+		for (const Result &result : results)
+		{
+			output << (result.ok ? "OK " : "ERROR ") << result.output.Size() << '\n';
+			result.output.WriteTo(output);
+			batchLatencies.push_back(result.latency);
+		}
+
+		output << std::flush;
+
+		latencies.insert(latencies.end(), batchLatencies.begin(), batchLatencies.end());
+		ReportLatency(batchLatencies, "Batch", log);
+	}
+
+	ReportLatency(latencies, "Session", log);
+}
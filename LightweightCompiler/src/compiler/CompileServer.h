@@ -0,0 +1,75 @@
+#pragma once
+#include <istream>
+#include <ostream>
+#include <string>
+#include <vector>
+#include "../parser/FlatAst.h"
+#include "../util/Arena.h"
+#include "../util/CodeBuffer.h"
+#include "../util/ThreadPool.h"
+
+/**
+* Long-running compiler that serves batches of programs over a pair of streams (usually stdin & stdout).
+* The workers, Arenas & FlatAsts are created once & reused by every request, so a request only pays for compiling its program.
+*
+* Request: "BATCH <count>\n", followed by <count> programs, each framed as "<length>\n<source bytes>".
+* Response: one frame per program, in request order: "OK <length>\n<asm bytes>" or "ERROR <length>\n<message bytes>".
+* A batch with too many or too long programs is skipped, and answered by a single ERROR frame.
+*/
+class CompileServer
+{
+private:
+	/* Warm state of a single worker. Only one request uses a Slot at a time */
+	struct Slot
+	{
+		/* Owns the visitor state of the request being compiled; reset after every request */
+		Arena arena;
+		/* Receives the parsed program; cleared before every request, keeping its storage */
+		FlatAst ast;
+	};
+
+	/* Result of a single request */
+	struct Result
+	{
+		bool ok;
+		/* The compiled ASM code, or the error message */
+		CodeBuffer output;
+		/* Compilation time in microseconds */
+		double latency;
+	};
+
+	ThreadPool pool;
+	std::vector<Slot> slots;
+	/* Latency of every request served so far, in microseconds */
+	std::vector<double> latencies;
+
+	/**
+	* Compiles a single program with given Slot's warm state.
+	*
+	* @param pool the workers that parse & compile the program in parallel, or NULL to compile it on the calling thread.
+	*/
+	void CompileRequest(Slot &slot, const std::string &source, Result &result, ThreadPool *pool);
+	/**
+	* Compiles a batch of programs. A single program is split between all workers, and larger batches are split program by program.
+	*/
+	void CompileBatch(const std::vector<std::string> &sources, std::vector<Result> &results);
+	/**
+	* Writes given latencies' 50th & 99th percentiles into given log stream.
+	*/
+	static void ReportLatency(std::vector<double> samples, const std::string &label, std::ostream &log);
+
+public:
+	/**
+	* Starts given amount of workers, or one per hardware thread if it's 0.
+	*/
+	CompileServer(size_t workerCount = 0);
+
+	/**
+	* Serves batches from given input until it ends. A malformed request is answered by a single ERROR frame, and the input is skipped up to the next batch.
+	*
+	* @param input the requests.
+	* @param output receives the responses. Flushed after every batch.
+	* @param log receives the latency report of every batch & of the whole session.
+	*/
+	void Serve(std::istream &input, std::ostream &output, std::ostream &log);
+};
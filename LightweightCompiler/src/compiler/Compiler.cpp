@@ -1,22 +1,663 @@
 #include "Compiler.h"
+#include "../parser/Parser.h"
+#include "../asm/ASMPrinter.h"
+#include "../util/Hash.h"
+#include <algorithm>
+#include <atomic>
+
+const char *const COMPILER_VERSION = "5";
 
 void ThrowCompileError(std::string error)
 {
-	std::cerr << "Compiler Error: " << error;
-	exit(1);
+	throw CompileError("Compiler Error: " + error);
 }
 
-std::string Compile(const ExprGroup *block)
+/* Smallest amount of AST nodes worth compiling on their own thread */
+static const size_t MIN_CHUNK_NODES = 16 * 1024;
+/* Chunks per worker, so workers that finish simple chunks early pick up more */
+static const size_t CHUNKS_PER_WORKER = 4;
+
+/* A chunk of top-level statements that's compiled on its own */
+struct CodeChunk
+{
+	/* The chunk's first top-level statement, and the one after its last */
+	size_t begin, end;
+	/* The chunk's first & one past last top-level declaration */
+	size_t firstVar, endVar;
+	/* Relocatable code of the chunk */
+	CodeBuffer code;
+	/* Whether the chunk wasn't compiled, but its code was reused from a BlockCache */
+	bool reused;
+	std::string_view reusedCode;
+	size_t labelCount, stackBytes;
+	/* Offsets of the chunk's top-level variables (firstVar to endVar), relative to the chunk's stack bytes */
+	std::vector<size_t> varOffsets;
+	/* Top-level variables the chunk uses from earlier chunks */
+	ChunkImports imports;
+	/* What the peephole pass did to the chunk's code, if it was compiled */
+	PeepholeStats peephole;
+
+	/**
+	* @return the length of the chunk's relocatable code, whether it was compiled or reused.
+	*/
+	size_t CodeLength() const
+	{
+		return reused ? reusedCode.length() : code.Size();
+	}
+};
+
+/**
+* Adds the variables that given top-level statement declares in the top-level scope to given scope.
+* Those are declared by the initializations that the top-level Visitor visits itself, rather than a block's Visitor.
+*/
+static void CollectTopLevelVars(const FlatAst &ast, TokenBuffer &tokens, NodeId statement, size_t chunk, TopLevelScope &scope)
 {
-	StatementVisitor visitor;
+	/* Initializations visited by the top-level Visitor, outermost first */
+	std::vector<NodeId> inits;
+	NodeId node = statement;
+
+	while (node != NO_NODE)
+	{
+		const FlatNode &current = ast[node];
+
+		switch (current.kind)
+		{
+		case NodeKind::INIT:
+			inits.push_back(node);
+			node = current.a == NO_NODE ? NO_NODE : ast[current.a].b;
+			break;
+
+		case NodeKind::ASSIGN:
+			node = current.b;
+			break;
+
+		case NodeKind::FOR:
+			node = ast.Children(node)[0];
+			break;
+
+		default:
+			node = NO_NODE;
+			break;
+		}
+	}
+
+	/* An initialization's value is visited before its variable is added */
+	for (auto iter = inits.rbegin(); iter != inits.rend(); iter++)
+	{
+		TokenType type = tokens.TypeAt(ast[*iter].token);
+		VarId id = tokens.At(ast[*iter].token + 1).literal;
+
+		scope.firstDeclarations.emplace(id, scope.vars.size());
+		scope.vars.push_back(TopLevelVar{ id, type, chunk });
+	}
+}
+
+/**
+* Compiles a single chunk with its own relocatable ASMGenerator. Runs on a worker thread.
+*
+* @param ast holds the chunk's statements, in its root's children begin to end.
+* @param view the Tokens, through a view that's used by this thread only.
+* @param index the chunk's position among all chunks of the program.
+* @param arena receives the chunk's visitor state. It's left for the caller to reset.
+* @param statementArena holds the Exprs of a single statement at a time.
+*/
+static void CompileChunk(const FlatAst &ast, TokenBuffer &view, const TopLevelScope &scope, CodeChunk &chunk, size_t index, Arena &arena, Arena &statementArena)
+{
+	const NodeId *statements = ast.Children(ast.root);
+
+	CompileContext context(arena, true);
+	ChunkVisitor visitor(&context, scope, index, chunk.imports);
+
+	NodeId first = chunk.begin == 0 ? 0 : statements[chunk.begin - 1] + 1;
+
+	for (size_t i = chunk.begin; i < chunk.end; i++)
+	{
+		Expr *statement = ast.Materialize(first, statements[i], view, statementArena);
+		statement->Accept(&visitor);
+		context.asmGen.Flush(chunk.code);
+
+		first = statements[i] + 1;
+		statementArena.Reset();
+	}
+
+	/* Record where the chunk's top-level variables are, relative to the chunk */
+	for (size_t i = chunk.firstVar; i < chunk.endVar; i++)
+	{
+		Token id{ TokenType::ID, scope.vars[i].id };
+		chunk.varOffsets.push_back(visitor.GetVar(&id)->memOffset);
+	}
+
+	chunk.labelCount = context.asmGen.LabelCount();
+	chunk.stackBytes = context.stackBytes;
+	chunk.peephole = context.asmGen.peephole;
+}
+
+/**
+* Joins the code of given compiled chunks in order: every chunk's labels & stack bytes are placed after the ones of the chunks before it,
+* and the variables it imports are resolved to the offsets of their declarations.
+*
+* @param scope the program's top-level variables, which the chunks were compiled with.
+* @param pool the workers that relocate the chunks, or NULL to relocate them on the calling thread.
+* @return the program's code.
+*/
+static CodeBuffer JoinChunks(const std::vector<CodeChunk> &chunks, const TopLevelScope &scope, ThreadPool *pool)
+{
+	std::vector<size_t> labelBases(chunks.size()), offsetBases(chunks.size());
+	size_t labelCount = 0, stackBytes = 0;
+
+	for (size_t c = 0; c < chunks.size(); c++)
+	{
+		labelBases[c] = labelCount;
+		offsetBases[c] = stackBytes;
+
+		labelCount += chunks[c].labelCount;
+		stackBytes += chunks[c].stackBytes;
+	}
+
+	/* Final offset of every top-level variable */
+	std::vector<size_t> varOffsets(scope.vars.size());
+
+	for (const CodeChunk &chunk : chunks)
+	{
+		for (size_t i = chunk.firstVar; i < chunk.endVar; i++)
+		{
+			varOffsets[i] = chunk.varOffsets[i - chunk.firstVar] + offsetBases[scope.vars[i].chunk];
+		}
+	}
+
+	/* Chunks are relocated range by range, each range into its own buffer. The buffers' pages are then joined in order without copying */
+	std::vector<CodeBuffer> relocated(chunks.size());
+
+	ForEachRange(pool, chunks.size(), [&chunks, &labelBases, &offsetBases, &varOffsets, &relocated](size_t begin, size_t end)
+	{
+		std::vector<size_t> importOffsets;
+		CodeBuffer &code = relocated[begin];
+
+		for (size_t c = begin; c < end; c++)
+		{
+			const CodeChunk &chunk = chunks[c];
+			importOffsets.clear();
+
+			for (size_t declaration : chunk.imports.declarations)
+			{
+				importOffsets.push_back(varOffsets[declaration]);
+			}
+
+			if (chunk.reused)
+			{
+				ASMPrinter::Relocate(chunk.reusedCode, labelBases[c], offsetBases[c], importOffsets, code);
+				continue;
+			}
+
+			/* Markers are never split between pages */
+			for (size_t page = 0; page < chunk.code.PageCount(); page++)
+			{
+				ASMPrinter::Relocate(chunk.code.PageAt(page), labelBases[c], offsetBases[c], importOffsets, code);
+			}
+		}
+	});
+
+	ASMGenerator asmGen;
+	CodeBuffer code;
+
+	asmGen.FilePrologue();
+	asmGen.Flush(code);
+
+	for (CodeBuffer &part : relocated)
+	{
+		code.Append(std::move(part));
+	}
+
+	asmGen.FileEpilogue();
+	asmGen.Flush(code);
+
+	return code;
+}
+
+/**
+* Adds the nodes of given FlatAst to given counts, by NodeKind.
+*/
+static void CountNodes(const FlatAst &ast, std::atomic<uint64_t> *counts)
+{
+	uint64_t local[NODE_KIND_COUNT] = {};
+
+	for (const FlatNode &node : ast.nodes)
+	{
+		local[(size_t) node.kind]++;
+	}
+
+	for (size_t k = 0; k < NODE_KIND_COUNT; k++)
+	{
+		if (local[k] != 0) counts[k].fetch_add(local[k], std::memory_order_relaxed);
+	}
+}
+
+/**
+* Adds the counters of a compilation's code to given Profiler: its labels, the parsed nodes by NodeKind, and what the peephole pass did.
+*/
+static void AddCodeCounters(Profiler *profiler, const std::atomic<uint64_t> *nodeCounts, size_t labelCount, const PeepholeStats &peephole)
+{
+	profiler->Add("labels", labelCount);
+
+	for (size_t k = 0; k < NODE_KIND_COUNT; k++)
+	{
+		profiler->Add(std::string("parsedNodes.") + NodeKindName((NodeKind) k), nodeCounts[k]);
+	}
+
+	profiler->Add("peephole.instructions", peephole.instructions);
+
+	for (size_t r = 0; r < PEEPHOLE_RULE_COUNT; r++)
+	{
+		profiler->Add(std::string("peephole.") + PeepholeRuleName((PeepholeRule) r) + ".applied", peephole.applied[r]);
+		profiler->Add(std::string("peephole.") + PeepholeRuleName((PeepholeRule) r) + ".removed", peephole.removed[r]);
+	}
+}
+
+/**
+* Adds the counters of the code of given compiled chunks to given Profiler (see AddCodeCounters).
+*/
+static void AddChunkCounters(Profiler *profiler, const std::atomic<uint64_t> *nodeCounts, const std::vector<CodeChunk> &chunks)
+{
+	size_t labelCount = 0;
+	PeepholeStats peephole;
+
+	for (const CodeChunk &chunk : chunks)
+	{
+		labelCount += chunk.labelCount;
+		peephole.Add(chunk.peephole);
+	}
+
+	AddCodeCounters(profiler, nodeCounts, labelCount, peephole);
+}
+
+/**
+* Compiles given chunks of top-level statements in parallel, and joins their code.
+*/
+static CodeBuffer CompileChunks(const FlatAst &ast, TokenBuffer &tokens, std::vector<CodeChunk> &chunks, ThreadPool &pool)
+{
+	const NodeId *statements = ast.Children(ast.root);
+
+	/* Layout pass: find the top-level variables, so every chunk can use the ones declared before it */
+	TopLevelScope scope;
+
+	for (size_t c = 0; c < chunks.size(); c++)
+	{
+		chunks[c].firstVar = scope.vars.size();
+
+		for (size_t i = chunks[c].begin; i < chunks[c].end; i++)
+		{
+			CollectTopLevelVars(ast, tokens, statements[i], c, scope);
+		}
+
+		chunks[c].endVar = scope.vars.size();
+	}
+
+	for (size_t c = 0; c < chunks.size(); c++)
+	{
+		pool.Submit([&ast, &tokens, &scope, &chunks, c]
+		{
+			/* The Tokens' lookup cache isn't shared between threads */
+			TokenBuffer view(tokens, tokens.Size());
+			Arena arena, statementArena;
+
+			CompileChunk(ast, view, scope, chunks[c], c, arena, statementArena);
+		});
+	}
+
+	pool.Wait();
+
+	return JoinChunks(chunks, scope, &pool);
+}
+
+CodeBuffer Compile(const FlatAst &ast, TokenBuffer &tokens, Arena &arena, ThreadPool *pool, Profiler *profiler)
+{
+	std::atomic<uint64_t> nodeCounts[NODE_KIND_COUNT] = {};
+
+	if (profiler != NULL)
+	{
+		CountNodes(ast, nodeCounts);
+	}
+
+	/* A single worker can't compile chunks in parallel */
+	if (pool != NULL && pool->WorkerCount() > 1)
+	{
+		const NodeId *statements = ast.Children(ast.root);
+		size_t chunkNodes = std::max(MIN_CHUNK_NODES, ast.nodes.size() / (pool->WorkerCount() * CHUNKS_PER_WORKER));
+
+		/* Split the top-level statements into chunks of about chunkNodes nodes. Statements' nodes follow each other */
+		std::vector<CodeChunk> chunks;
+		size_t begin = 0;
+		NodeId first = 0;
+
+		for (size_t i = 0; i < ast.ChildCount(ast.root); i++)
+		{
+			if (statements[i] + 1 - first >= chunkNodes || i + 1 == ast.ChildCount(ast.root))
+			{
+				CodeChunk &chunk = chunks.emplace_back();
+				chunk.begin = begin;
+				chunk.end = i + 1;
+				begin = i + 1;
+				first = statements[i] + 1;
+			}
+		}
+
+		if (chunks.size() > 1)
+		{
+			CodeBuffer code = CompileChunks(ast, tokens, chunks, *pool);
+
+			if (profiler != NULL)
+			{
+				AddChunkCounters(profiler, nodeCounts, chunks);
+			}
+
+			return code;
+		}
+	}
+
+	CompileContext context(arena);
+	StatementVisitor visitor(&context);
+	/* Holds the Exprs of a single top-level statement at a time */
+	Arena statementArena;
+
+	CodeBuffer code;
 
 	visitor.asmGen->FilePrologue();
 	//visitor.asmGen->EnterMethod();
+	visitor.asmGen->Flush(code);
 
-	visitor.Visit(block);
+	/* Statement nodes end their ranges, so every statement starts right after the previous one */
+	NodeId first = 0;
+	const NodeId *statements = ast.Children(ast.root);
+
+	for (size_t i = 0; i < ast.ChildCount(ast.root); i++)
+	{
+		Expr *statement = ast.Materialize(first, statements[i], tokens, statementArena);
+		statement->Accept(&visitor);
+		visitor.asmGen->Flush(code);
+
+		first = statements[i] + 1;
+		statementArena.Reset();
+	}
 
 	//visitor.asmGen->ExitMethod();
 	visitor.asmGen->FileEpilogue();
+	visitor.asmGen->Flush(code);
+
+	if (profiler != NULL)
+	{
+		AddCodeCounters(profiler, nodeCounts, visitor.asmGen->LabelCount(), visitor.asmGen->peephole);
+	}
+
+	return code;
+}
+
+/**
+* Hashes the types & literals of the Tokens in [start, end).
+*/
+static uint64_t HashTokens(TokenBuffer &tokens, size_t start, size_t end)
+{
+	uint64_t hash = 0;
+
+	for (size_t i = start; i < end; i++)
+	{
+		Token token = tokens.At(i);
+		hash = HashBytes(token.literal, hash * 31 + (uint64_t) token.type);
+	}
+
+	return hash;
+}
+
+/**
+* Checks whether given cached block's names are bound the same way in given scope, as they would be for the block at given position.
+*/
+static bool BindingsMatch(const BlockCache &cache, const CachedBlock &cached, const TopLevelScope &scope, size_t block)
+{
+	const CachedBinding *bindings = cache.Bindings(cached);
+
+	for (size_t i = 0; i < cached.bindingCount; i++)
+	{
+		const CachedBinding &binding = bindings[i];
+		auto iterator = scope.firstDeclarations.find(cache.Text(binding.id));
+		TokenType type = TokenType::INVALID;
+
+		if (iterator != scope.firstDeclarations.end() && scope.vars[iterator->second].chunk < block)
+		{
+			type = scope.vars[iterator->second].type;
+		}
+
+		if (type != binding.type)
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+CodeBuffer CompileIncremental(TokenBuffer &tokens, BlockCache &cache, ThreadPool *pool, ReuseReport &report, Profiler *profiler)
+{
+	/* Blocks are only known once all Tokens are */
+	tokens.Fill();
+
+	Profiler::Phase parsePhase(profiler, "parse");
+	/* Nodes of the parsed blocks, by NodeKind */
+	std::atomic<uint64_t> nodeCounts[NODE_KIND_COUNT] = {};
+
+	std::vector<size_t> starts = SplitTopLevel(tokens, 1);
+	size_t blockCount = starts.size() - 1;
+
+	std::vector<uint64_t> tokenHashes(blockCount);
+
+	ForEachRange(pool, blockCount, [&tokens, &starts, &tokenHashes](size_t begin, size_t end)
+	{
+		/* The Tokens' lookup cache isn't shared between threads */
+		TokenBuffer view(tokens, tokens.Size());
+
+		for (size_t b = begin; b < end; b++)
+		{
+			tokenHashes[b] = HashTokens(view, starts[b], starts[b + 1]);
+		}
+	});
+
+	/* Blocks with the same Tokens declare the same variables, so a cached block's declarations can be used before its bindings are checked */
+	std::vector<const CachedBlock *> candidates(blockCount);
+	std::vector<FlatAst> asts(blockCount);
+	std::vector<size_t> parsed;
+
+	for (size_t b = 0; b < blockCount; b++)
+	{
+		candidates[b] = cache.Find(tokenHashes[b]);
+		if (candidates[b] == NULL) parsed.push_back(b);
+	}
+
+	ForEachRange(pool, parsed.size(), [&tokens, &starts, &asts, &parsed, &nodeCounts](size_t begin, size_t end)
+	{
+		for (size_t i = begin; i < end; i++)
+		{
+			ParseChunk(tokens, asts[parsed[i]], starts[parsed[i]], starts[parsed[i] + 1]);
+			CountNodes(asts[parsed[i]], nodeCounts);
+		}
+	});
+
+	/* Layout pass: find the top-level variables, of parsed blocks in their ASTs & of cached blocks in the cache */
+	TopLevelScope scope;
+	std::vector<CodeChunk> chunks(blockCount);
+
+	for (size_t b = 0; b < blockCount; b++)
+	{
+		chunks[b].firstVar = scope.vars.size();
+
+		if (candidates[b] == NULL)
+		{
+			const FlatAst &ast = asts[b];
+			chunks[b].end = ast.ChildCount(ast.root);
+
+			for (size_t i = 0; i < chunks[b].end; i++)
+			{
+				CollectTopLevelVars(ast, tokens, ast.Children(ast.root)[i], b, scope);
+			}
+		}
+		else
+		{
+			const CachedDeclaration *declarations = cache.Declarations(*candidates[b]);
+
+			for (size_t i = 0; i < candidates[b]->declarationCount; i++)
+			{
+				VarId id = cache.Text(declarations[i].id);
 
-	return visitor.asmGen->code;
-}
\ No newline at end of file
+				scope.firstDeclarations.emplace(id, scope.vars.size());
+				scope.vars.push_back(TopLevelVar{ id, declarations[i].type, b });
+			}
+		}
+
+		chunks[b].endVar = scope.vars.size();
+	}
+
+	/* Reuse the code of cached blocks whose names are bound the same way. The other blocks are compiled */
+	std::vector<const CachedBlock *> reused(blockCount);
+	std::vector<size_t> compiled;
+
+	for (size_t b = 0; b < blockCount; b++)
+	{
+		const CachedBlock *cached = candidates[b];
+
+		while (cached != NULL && !BindingsMatch(cache, *cached, scope, b))
+		{
+			cached = cache.Find(tokenHashes[b], cached);
+		}
+
+		if (cached == NULL)
+		{
+			compiled.push_back(b);
+			continue;
+		}
+
+		CodeChunk &chunk = chunks[b];
+
+		const CachedDeclaration *declarations = cache.Declarations(*cached);
+		const CachedBinding *bindings = cache.Bindings(*cached);
+
+		reused[b] = cached;
+		chunk.reused = true;
+		chunk.reusedCode = cache.Text(cached->code);
+		chunk.labelCount = cached->labelCount;
+		chunk.stackBytes = cached->stackBytes;
+
+		for (size_t i = 0; i < cached->declarationCount; i++)
+		{
+			chunk.varOffsets.push_back(declarations[i].offset);
+		}
+
+		for (size_t i = 0; i < cached->importCount; i++)
+		{
+			chunk.imports.declarations.push_back(scope.firstDeclarations.at(cache.Text(bindings[i].id)));
+		}
+	}
+
+	parsePhase.End();
+	Profiler::Phase codegenPhase(profiler, "codegen");
+
+	ForEachRange(pool, compiled.size(), [&tokens, &starts, &asts, &candidates, &scope, &chunks, &compiled, &nodeCounts](size_t begin, size_t end)
+	{
+		/* The Tokens' lookup cache isn't shared between threads; the Arenas are reused by all blocks of the range */
+		TokenBuffer view(tokens, tokens.Size());
+		Arena arena, statementArena;
+
+		for (size_t i = begin; i < end; i++)
+		{
+			size_t b = compiled[i];
+			FlatAst &ast = asts[b];
+
+			/* Cached blocks whose bindings changed weren't parsed yet */
+			if (candidates[b] != NULL)
+			{
+				ParseChunk(tokens, ast, starts[b], starts[b + 1]);
+				CountNodes(ast, nodeCounts);
+				chunks[b].end = ast.ChildCount(ast.root);
+			}
+
+			CompileChunk(ast, view, scope, chunks[b], b, arena, statementArena);
+
+			ast = FlatAst();
+			arena.Reset();
+		}
+	});
+
+	CodeBuffer code = JoinChunks(chunks, scope, pool);
+
+	codegenPhase.End();
+	Profiler::Phase updatePhase(profiler, "updateBlocks");
+
+	report = ReuseReport{ blockCount, blockCount - compiled.size(), tokens.Size(), 0, 0, 0 };
+
+	for (size_t b = 0; b < blockCount; b++)
+	{
+		size_t length = chunks[b].CodeLength();
+		report.codeBytes += length;
+
+		if (reused[b] != NULL)
+		{
+			report.reusedTokens += starts[b + 1] - starts[b];
+			report.reusedCodeBytes += length;
+		}
+	}
+
+	/* Describe the compiled blocks while their names (which may view into the cache's text) are still valid */
+	std::vector<CompiledBlock> blocks;
+
+	for (size_t b : compiled)
+	{
+		CodeChunk &chunk = chunks[b];
+		CompiledBlock block{};
+		block.tokenHash = tokenHashes[b];
+
+		for (size_t i = chunk.firstVar; i < chunk.endVar; i++)
+		{
+			block.declarations.push_back(CompiledDeclaration{ std::string(scope.vars[i].id), scope.vars[i].type, chunk.varOffsets[i - chunk.firstVar] });
+		}
+
+		for (size_t declaration : chunk.imports.declarations)
+		{
+			block.bindings.push_back(CompiledBinding{ std::string(scope.vars[declaration].id), scope.vars[declaration].type });
+		}
+
+		/* A name that's missing once is missing every time it's looked up */
+		std::sort(chunk.imports.missing.begin(), chunk.imports.missing.end());
+		chunk.imports.missing.erase(std::unique(chunk.imports.missing.begin(), chunk.imports.missing.end()), chunk.imports.missing.end());
+
+		for (VarId id : chunk.imports.missing)
+		{
+			block.bindings.push_back(CompiledBinding{ std::string(id), TokenType::INVALID });
+		}
+
+		block.importCount = chunk.imports.declarations.size();
+		block.code = std::move(chunk.code);
+		block.labelCount = chunk.labelCount;
+		block.stackBytes = chunk.stackBytes;
+
+		blocks.push_back(std::move(block));
+	}
+
+	/* Keep the blocks of this compilation for the next one, and drop the rest */
+	cache.Retain(reused);
+
+	for (const CompiledBlock &block : blocks)
+	{
+		cache.Add(block);
+	}
+
+	updatePhase.End();
+
+	if (profiler != NULL)
+	{
+		profiler->Add("tokens", report.tokens);
+		profiler->Add("blocks", report.blocks);
+		profiler->Add("reusedBlocks", report.reusedBlocks);
+		profiler->Add("reusedTokens", report.reusedTokens);
+
+		/* Counts the compiled blocks only; reused blocks were parsed & optimized when they were compiled */
+		AddChunkCounters(profiler, nodeCounts, chunks);
+	}
+
+	return code;
+}
@@ -2,13 +2,66 @@
 #include <string>
 #include <stack>
 #include <vector>
+#include "CompileError.h"
 #include "../parser/Expr.h"
+#include "../parser/FlatAst.h"
+#include "../tokens/TokenBuffer.h"
 #include "../tables/VarTable.h"
+#include "../util/Arena.h"
+#include "../util/ThreadPool.h"
+#include "../util/Profiler.h"
 #include "../asm/ASMGenerator.h"
+#include "../cache/BlockCache.h"
 #include "../visitors/StatementVisitor.h"
 #include "../visitors/ValueVisitor.h"
 #include "../visitors/ControllableVisitor.h"
+#include "../visitors/ChunkVisitor.h"
 
+/* Version of the generated code. Bumped whenever the code generated for a program changes, so builds cached by older versions aren't reused */
+extern const char *const COMPILER_VERSION;
+
+/**
+* Stops the current compilation with a CompileError.
+*/
 void ThrowCompileError(std::string error);
 
-std::string Compile(const ExprGroup *block);
+/**
+* Compiles the program one top-level statement at a time: each statement is materialized into Exprs, visited & released,
+* so only a single statement's Exprs exist at any point.
+* With a ThreadPool, large programs are split into chunks of top-level statements that are compiled in parallel, each with its own ASMGenerator.
+* Their labels & variable offsets are numbered from 0 & relocated when the chunks are joined, so the code is the same as when compiling serially.
+* Compilations share no state, so any amount of them can run at the same time.
+*
+* @param ast the parsed program.
+* @param tokens the Tokens the program was parsed from.
+* @param arena the compilation's Arena. All visitor state is allocated from it.
+* @param pool the workers that compile the chunks, or NULL to compile serially.
+* @param profiler receives counters of the labels, the parsed nodes by NodeKind & the peephole pass. NULL to count nothing.
+* @return the compiled ASM code, to be written out page by page.
+*/
+CodeBuffer Compile(const FlatAst &ast, TokenBuffer &tokens, Arena &arena, ThreadPool *pool = NULL, Profiler *profiler = NULL);
+
+/* How much of a program's previous compilation was reused by an incremental compilation */
+struct ReuseReport
+{
+	/* Top-level blocks of the program, and the ones whose code was reused */
+	size_t blocks, reusedBlocks;
+	/* Tokens of the program, and the ones in reused blocks (which weren't parsed or compiled) */
+	size_t tokens, reusedTokens;
+	/* Bytes of relocatable code of the program, and the ones that were reused */
+	size_t codeBytes, reusedCodeBytes;
+};
+
+/**
+* Compiles the program one top-level block (a top-level statement & the blank lines after it) at a time, reusing the code of blocks that didn't change.
+* A block's code is reused when the previous compilation had a block with the same Tokens, whose names are bound the same way (see CachedBlock).
+* Only the other blocks are parsed & compiled, in parallel; then the code of all blocks is relocated & joined. The code is the same as Compile's.
+*
+* @param tokens the program's Tokens.
+* @param cache blocks of the previous compilation. Once compiled, it holds the blocks of this compilation instead, to be reused by the next one.
+* @param pool the workers that parse, compile & join the blocks, or NULL to do it on the calling thread.
+* @param report receives how much of the previous compilation was reused.
+* @param profiler receives the parse, codegen & updateBlocks phases, and counters of the Tokens, blocks, labels & parsed nodes by NodeKind. NULL to measure nothing.
+* @return the compiled ASM code.
+*/
+CodeBuffer CompileIncremental(TokenBuffer &tokens, BlockCache &cache, ThreadPool *pool, ReuseReport &report, Profiler *profiler = NULL);
@@ -11,6 +11,12 @@
 class Expr
 {
 public:
+	/**
+	* Registers needed to evaluate the expression without spilling any value (its Sethi-Ullman number), set when the Expr is built.
+	* 0 for leaves that an instruction can use as an operand as they are (literals & variables).
+	*/
+	uint8_t registers = 1;
+
 	virtual std::ostream &Repr(std::ostream &stream) const = 0;
 
 	virtual void Accept(IVisitor *visitor) const = 0;
@@ -235,26 +241,26 @@ public:
 class ArrayExpr : public Expr
 {
 public:
-	std::vector<const Expr *> *values;
+	std::vector<const Expr *> values;
 
 	ArrayExpr()
 	{
-		this->values = new std::vector<const Expr *>();
+		this->values = std::vector<const Expr *>();
 	}
 
 	void Add(const Expr *expr)
 	{
-		this->values->push_back(expr);
+		this->values.push_back(expr);
 	}
 
 	std::ostream &Repr(std::ostream &stream) const override
 	{
 		stream << "[";
 
-		for (size_t i = 0; i < values->size(); i++)
+		for (size_t i = 0; i < values.size(); i++)
 		{
-			values->at(i)->Repr(stream);
-			if (i < values->size() - 1) stream << ", ";
+			values.at(i)->Repr(stream);
+			if (i < values.size() - 1) stream << ", ";
 		}
 
 		stream << "]";
@@ -437,7 +443,32 @@ public:
 	void Accept(IVisitor *visitor) const override;
 };
 
-class WhileExpr : public Expr
+/* A variable that a loop may keep in a register */
+struct LoopVar
+{
+	Token *id;
+	/* Accesses of the variable in the loop's condition, increment & block */
+	uint32_t uses;
+	/* Whether the loop assigns the variable, so its register must be written back to its memory when the loop exits */
+	bool assigned;
+};
+
+/**
+* Base class of loops, which holds the variables that a loop may keep in registers while it runs, found when its Expr is built.
+* Candidates are the scalar variables that the loop accesses but doesn't declare, so all of their accesses in the loop refer to the same variable.
+*/
+class LoopExpr : public Expr
+{
+public:
+	/* Most candidates a loop keeps, as only a few registers can hold them */
+	static constexpr size_t MAX_VARS = 6;
+
+	/* The candidates: a for-loop's own variable first, then the rest by uses */
+	const LoopVar *vars = NULL;
+	size_t varCount = 0;
+};
+
+class WhileExpr : public LoopExpr
 {
 public:
 	CondExpr *cond;
@@ -462,7 +493,7 @@ public:
 	}
 };
 
-class ForExpr : public Expr
+class ForExpr : public LoopExpr
 {
 public:
 	Expr *assign, *incr;
@@ -0,0 +1,397 @@
+#include "FlatAst.h"
+#include "Expr.h"
+#include "../tokens/TokenBuffer.h"
+#include "../util/Arena.h"
+#include <algorithm>
+#include <string_view>
+#include <unordered_map>
+
+const char *NodeKindName(NodeKind kind)
+{
+	static const char *const NAMES[NODE_KIND_COUNT] = {
+		"GROUP", "LIT", "UNARY", "BINARY", "PAREN", "TERN", "COND", "ACCESS", "ARRAY",
+		"PRINT", "ASSIGN", "INIT", "IF", "ELSE", "CONTROL_FLOW", "WHILE", "FOR", "FUNC",
+	};
+
+	return NAMES[(size_t) kind];
+}
+
+FlatAst::FlatAst() :
+	root(NO_NODE)
+{
+}
+
+void FlatAst::Clear()
+{
+	nodes.clear();
+	links.clear();
+	root = NO_NODE;
+}
+
+NodeId FlatAst::Add(NodeKind kind, uint32_t token, NodeId a, NodeId b, NodeId c)
+{
+	nodes.push_back(FlatNode{ kind, token, a, b, c });
+	return (NodeId) (nodes.size() - 1);
+}
+
+NodeId FlatAst::AddList(NodeKind kind, const NodeId *children, size_t count)
+{
+	NodeId first = (NodeId) links.size();
+	links.insert(links.end(), children, children + count);
+
+	return Add(kind, 0, first, (NodeId) count);
+}
+
+/**
+* @return the registers needed to evaluate given value node, whose children's Exprs were built (see Expr::registers).
+*/
+static uint8_t SethiUllman(const FlatNode &node, const Expr *a, const Expr *b, const Expr *c)
+{
+	switch (node.kind)
+	{
+	case NodeKind::LIT:
+		return 0;
+
+	case NodeKind::ACCESS:
+		return a == NULL ? 0 : 1;
+
+	case NodeKind::PAREN:
+		return a->registers;
+
+	case NodeKind::UNARY:
+	case NodeKind::COND:
+		return std::max<uint8_t>(a->registers, 1);
+
+	case NodeKind::BINARY:
+	{
+		/* The left operand is the instruction's destination, so it's always in a register. The right one needs none if it's a leaf */
+		uint8_t left = std::max<uint8_t>(a->registers, 1), right = b->registers;
+		return left == right ? (uint8_t) std::min(left + 1, UINT8_MAX) : std::max(left, right);
+	}
+
+	case NodeKind::TERN:
+		return std::max({ a->registers, b->registers, c->registers, (uint8_t) 1 });
+
+	default:
+		return 1;
+	}
+}
+
+/**
+* @return whether given node's children are in links (see FlatNode).
+*/
+static bool IsList(NodeKind kind)
+{
+	return kind == NodeKind::GROUP || kind == NodeKind::ARRAY || kind == NodeKind::FOR;
+}
+
+/**
+* Finds the variables that a loop may keep in registers (see LoopExpr), by scanning the loop's nodes in a single pass.
+*
+* @param begin, end the range of nodes that run on every iteration: the condition, increment & block.
+* @param header the name of the variable that a for-loop's header assigns, which is preferred, or an empty name.
+*/
+static void FindLoopVars(const FlatAst &ast, NodeId begin, NodeId end, std::string_view header, TokenBuffer &tokens, Arena &arena, LoopExpr *loop)
+{
+	struct Candidate
+	{
+		uint32_t token;
+		uint32_t uses;
+		bool assigned, excluded;
+	};
+
+	std::unordered_map<std::string_view, Candidate> candidates;
+
+	for (NodeId id = begin; id < end; id++)
+	{
+		const FlatNode &node = ast[id];
+
+		switch (node.kind)
+		{
+		case NodeKind::ACCESS:
+		{
+			Candidate &candidate = candidates.try_emplace(tokens.At(node.token).literal, Candidate{ node.token, 0, false, false }).first->second;
+			candidate.uses++;
+			/* Indexed variables aren't scalars */
+			candidate.excluded |= node.a != NO_NODE;
+			break;
+		}
+
+		case NodeKind::ASSIGN:
+			/* The assigned ACCESS comes before the ASSIGN, so it's a candidate already */
+			candidates[tokens.At(ast[node.a].token).literal].assigned = true;
+			break;
+
+		case NodeKind::INIT:
+		{
+			/* A variable declared in the loop is another variable on every iteration, & hides any variable of the same name */
+			Token declared = tokens.At(node.token + 1);
+			candidates.try_emplace(declared.literal, Candidate{ node.token + 1, 0, false, true }).first->second.excluded = true;
+			break;
+		}
+
+		case NodeKind::FUNC:
+			/* A function's frame is elsewhere, so no variable can stay in a register across it */
+			return;
+
+		default:
+			break;
+		}
+	}
+
+	std::vector<std::pair<std::string_view, Candidate>> chosen;
+
+	for (const auto &candidate : candidates)
+	{
+		if (!candidate.second.excluded)
+		{
+			chosen.push_back(candidate);
+		}
+	}
+
+	/* The header's variable first, then by uses. Ties are broken by position, so the order doesn't depend on the hash map's */
+	std::sort(chosen.begin(), chosen.end(), [header](const auto &a, const auto &b)
+	{
+		if ((a.first == header) != (b.first == header))
+		{
+			return a.first == header;
+		}
+
+		return a.second.uses != b.second.uses ? a.second.uses > b.second.uses : a.second.token < b.second.token;
+	});
+
+	loop->varCount = std::min(chosen.size(), LoopExpr::MAX_VARS);
+
+	if (loop->varCount == 0)
+	{
+		return;
+	}
+
+	LoopVar *vars = (LoopVar *) arena.Allocate(sizeof(LoopVar) * loop->varCount, alignof(LoopVar));
+
+	for (size_t i = 0; i < loop->varCount; i++)
+	{
+		vars[i] = LoopVar{ arena.New<Token>(tokens.At(chosen[i].second.token)), chosen[i].second.uses, chosen[i].second.assigned };
+	}
+
+	loop->vars = vars;
+}
+
+Expr *FlatAst::Materialize(NodeId first, NodeId last, TokenBuffer &tokens, Arena &arena) const
+{
+	/* Expr of every node in the range, by its offset from first */
+	std::vector<Expr *> built(last - first + 1);
+	/* First node of every node's subtree, by its offset from first. A subtree is a contiguous range that ends with its root */
+	std::vector<NodeId> starts(last - first + 1);
+
+	auto Child = [&](NodeId child) -> Expr *
+	{
+		return child == NO_NODE ? NULL : built[child - first];
+	};
+
+	auto TokenAt = [&](uint32_t token) -> Token *
+	{
+		return arena.New<Token>(tokens.At(token));
+	};
+
+	auto Start = [&](NodeId node) -> NodeId
+	{
+		return starts[node - first];
+	};
+
+	for (NodeId id = first; id <= last; id++)
+	{
+		const FlatNode &node = nodes[id];
+		Expr *expr = NULL;
+
+		switch (node.kind)
+		{
+		case NodeKind::GROUP:
+		{
+			ExprGroup *group = arena.New<ExprGroup>();
+			group->exprs.reserve(node.b);
+
+			for (NodeId i = 0; i < node.b; i++)
+			{
+				group->Add(Child(links[node.a + i]));
+			}
+
+			expr = group;
+			break;
+		}
+
+		case NodeKind::LIT:
+			expr = arena.New<LitExpr>(TokenAt(node.token));
+			break;
+
+		case NodeKind::UNARY:
+			expr = arena.New<UnaryExpr>(TokenAt(node.token), Child(node.a));
+			break;
+
+		case NodeKind::BINARY:
+			expr = arena.New<BinaryExpr>(Child(node.a), Child(node.b), TokenAt(node.token));
+			break;
+
+		case NodeKind::PAREN:
+			expr = arena.New<GroupExpr>(Child(node.a));
+			break;
+
+		case NodeKind::TERN:
+			expr = arena.New<TernExpr>(Child(node.a), Child(node.b), Child(node.c));
+			break;
+
+		case NodeKind::COND:
+			expr = arena.New<CondExpr>(Child(node.a));
+			break;
+
+		case NodeKind::ACCESS:
+			expr = arena.New<AccessibleExpr>(TokenAt(node.token), Child(node.a));
+			break;
+
+		case NodeKind::ARRAY:
+		{
+			ArrayExpr *array = arena.New<ArrayExpr>();
+			array->values.reserve(node.b);
+
+			for (NodeId i = 0; i < node.b; i++)
+			{
+				array->Add(Child(links[node.a + i]));
+			}
+
+			expr = array;
+			break;
+		}
+
+		case NodeKind::PRINT:
+			expr = arena.New<PrintExpr>(Child(node.a));
+			break;
+
+		case NodeKind::ASSIGN:
+			expr = arena.New<AssignExpr>((AccessibleExpr *) Child(node.a), TokenAt(node.token), Child(node.b));
+			break;
+
+		case NodeKind::INIT:
+			expr = arena.New<InitExpr>(TokenAt(node.token), TokenAt(node.token + 1), (AssignExpr *) Child(node.a));
+			break;
+
+		case NodeKind::IF:
+			expr = arena.New<IfExpr>((CondExpr *) Child(node.a), (ExprGroup *) Child(node.b), (IfExpr *) Child(node.c));
+			break;
+
+		case NodeKind::ELSE:
+			expr = arena.New<ElseExpr>((IfExpr *) Child(node.a), (ExprGroup *) Child(node.b));
+			break;
+
+		case NodeKind::CONTROL_FLOW:
+			expr = arena.New<ControlFlowExpr>(TokenAt(node.token));
+			break;
+
+		case NodeKind::WHILE:
+		{
+			WhileExpr *loop = arena.New<WhileExpr>((CondExpr *) Child(node.a), (ExprGroup *) Child(node.b));
+			FindLoopVars(*this, std::min(Start(node.a), Start(node.b)), id, std::string_view(), tokens, arena, loop);
+
+			expr = loop;
+			break;
+		}
+
+		case NodeKind::FOR:
+		{
+			const NodeId *children = links.data() + node.a;
+			ForExpr *loop = arena.New<ForExpr>(Child(children[0]), (CondExpr *) Child(children[1]), Child(children[2]), (ExprGroup *) Child(children[3]));
+
+			/* The header's assignment runs once, before the loop */
+			const FlatNode &assign = nodes[children[0]];
+			std::string_view header;
+
+			if (assign.kind == NodeKind::INIT)
+			{
+				header = tokens.At(assign.token + 1).literal;
+			}
+			else if (assign.kind == NodeKind::ASSIGN)
+			{
+				header = tokens.At(nodes[assign.a].token).literal;
+			}
+
+			FindLoopVars(*this, std::min({ Start(children[1]), Start(children[2]), Start(children[3]) }), id, header, tokens, arena, loop);
+
+			expr = loop;
+			break;
+		}
+
+		case NodeKind::FUNC:
+			expr = arena.New<FuncExpr>(TokenAt(node.token), TokenAt(node.token + 1), Child(node.a));
+			break;
+		}
+
+		/* Value nodes (LIT to ACCESS) refer to their children directly, & are numbered after them */
+		if (node.kind >= NodeKind::LIT && node.kind <= NodeKind::ACCESS)
+		{
+			expr->registers = SethiUllman(node, Child(node.a), Child(node.b), Child(node.c));
+		}
+
+		/* A subtree starts where its earliest child's subtree does */
+		NodeId start = id;
+
+		if (IsList(node.kind))
+		{
+			for (NodeId i = 0; i < node.b; i++)
+			{
+				start = std::min(start, Start(links[node.a + i]));
+			}
+		}
+		else
+		{
+			for (NodeId child : { node.a, node.b, node.c })
+			{
+				if (child != NO_NODE)
+				{
+					start = std::min(start, Start(child));
+				}
+			}
+		}
+
+		built[id - first] = expr;
+		starts[id - first] = start;
+	}
+
+	return built[last - first];
+}
+
+void FlatAst::CopyBlock(const FlatAst &other, NodeId nodeBase, NodeId linkBase)
+{
+	auto Offset = [nodeBase](NodeId node)
+	{
+		return node == NO_NODE ? NO_NODE : node + nodeBase;
+	};
+
+	for (NodeId id = 0; id < other.root; id++)
+	{
+		FlatNode node = other.nodes[id];
+
+		if (IsList(node.kind))
+		{
+			/* List nodes refer to their first link & hold a count */
+			node.a += linkBase;
+		}
+		else
+		{
+			node.a = Offset(node.a);
+			node.b = Offset(node.b);
+			node.c = Offset(node.c);
+		}
+
+		nodes[nodeBase + id] = node;
+	}
+
+	/* The root's links are the last ones, since the root is completed last */
+	for (NodeId i = 0; i < other.nodes[other.root].a; i++)
+	{
+		links[linkBase + i] = other.links[i] + nodeBase;
+	}
+}
+
+size_t FlatAst::BytesUsed() const
+{
+	return nodes.size() * sizeof(FlatNode) + links.size() * sizeof(NodeId);
+}
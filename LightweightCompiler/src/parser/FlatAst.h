@@ -0,0 +1,141 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class Expr;
+class Arena;
+class TokenBuffer;
+
+/* Index of a node inside a FlatAst */
+using NodeId = uint32_t;
+/* Marks a missing optional child */
+constexpr NodeId NO_NODE = UINT32_MAX;
+
+/* Kind of a FlatNode. Every kind matches one Expr class; the comments list how the node's fields are used */
+enum class NodeKind : uint8_t
+{
+	GROUP, // ExprGroup. a: first link, b: statement count
+	LIT, // LitExpr. token: value
+	UNARY, // UnaryExpr. token: oper, a: value
+	BINARY, // BinaryExpr. token: oper, a: left, b: right
+	PAREN, // GroupExpr. a: value
+	TERN, // TernExpr. a: cond, b: caseTrue, c: caseFalse
+	COND, // CondExpr. a: cond
+	ACCESS, // AccessibleExpr. token: id, a: index (optional)
+	ARRAY, // ArrayExpr. a: first link, b: value count
+	PRINT, // PrintExpr. a: value
+	ASSIGN, // AssignExpr. token: assignOper, a: var (ACCESS), b: value
+	INIT, // InitExpr. token: type (the id is the next Token), a: assign (optional)
+	IF, // IfExpr. a: cond, b: block, c: elif (optional)
+	ELSE, // ElseExpr. a: if, b: block
+	CONTROL_FLOW, // ControlFlowExpr. token: stmt
+	WHILE, // WhileExpr. a: cond, b: block
+	FOR, // ForExpr. a: first link (assign, cond, incr & block)
+	FUNC, // FuncExpr. token: type (the id is the next Token), a: body
+};
+
+/* Amount of NodeKinds */
+constexpr size_t NODE_KIND_COUNT = (size_t) NodeKind::FUNC + 1;
+
+/**
+* @return the name of given NodeKind, as written in the enum.
+*/
+const char *NodeKindName(NodeKind kind);
+
+/**
+* A single AST node. Children are referenced by their NodeId & Tokens by their index in the TokenBuffer, so a node holds no pointers.
+*/
+struct FlatNode
+{
+	NodeKind kind;
+	/* Index of the node's Token in the TokenBuffer */
+	uint32_t token;
+	/* Children, as listed by NodeKind */
+	NodeId a, b, c;
+};
+
+/**
+* AST stored as one contiguous array of nodes, instead of a graph of separately allocated Exprs.
+* Nodes are added in post order (children before their parents), so every statement's nodes form a contiguous
+* range that ends with the statement's own node. That range can be materialized into regular Exprs for the visitors, one statement at a time.
+*/
+class FlatAst
+{
+public:
+	/* Every node, in the order they were added */
+	std::vector<FlatNode> nodes;
+	/* Children of list nodes (GROUP/ARRAY/FOR). Every list is stored contiguously */
+	std::vector<NodeId> links;
+	/* The top-level block */
+	NodeId root;
+
+	FlatAst();
+
+	/**
+	* Removes every node & link, keeping their storage so the FlatAst can be reused for another program without reallocating.
+	*/
+	void Clear();
+
+	/**
+	* Adds a node with given fields.
+	*
+	* @return the new node's NodeId.
+	*/
+	NodeId Add(NodeKind kind, uint32_t token, NodeId a = NO_NODE, NodeId b = NO_NODE, NodeId c = NO_NODE);
+	/**
+	* Adds a list node whose children are given nodes.
+	*
+	* @return the new node's NodeId.
+	*/
+	NodeId AddList(NodeKind kind, const NodeId *children, size_t count);
+
+	const FlatNode &operator[](NodeId node) const
+	{
+		return nodes[node];
+	}
+
+	/**
+	* @param node a list node (GROUP/ARRAY/FOR).
+	* @return the list's first child. The rest of the children follow it.
+	*/
+	const NodeId *Children(NodeId node) const
+	{
+		return links.data() + nodes[node].a;
+	}
+
+	/**
+	* @param block a GROUP node.
+	* @return the amount of statements in the block.
+	*/
+	size_t ChildCount(NodeId block) const
+	{
+		return nodes[block].b;
+	}
+
+	/**
+	* Builds Exprs for the nodes in range [first, last], which must hold complete subtrees (e.g. a single top-level statement).
+	* Nodes come after their children, so the Exprs are built in a single forward pass, without recursion.
+	*
+	* @param tokens the Tokens the nodes were parsed from.
+	* @param arena the Arena that will own the built Exprs & Tokens.
+	* @return the Expr of the last node in the range.
+	*/
+	Expr *Materialize(NodeId first, NodeId last, TokenBuffer &tokens, Arena &arena) const;
+
+	/**
+	* Copies the nodes of another FlatAst, parsed from the same Tokens, into this FlatAst at given positions, which must already exist.
+	* The other FlatAst's root must be its last node & is left out, so its top-level statements can be joined with other blocks' statements.
+	* Copies into distinct positions can run in parallel.
+	*
+	* @param other the FlatAst to copy.
+	* @param nodeBase where the copied nodes start. Takes other's node count - 1 nodes.
+	* @param linkBase where the copied links start. Takes other's root's first link links.
+	*/
+	void CopyBlock(const FlatAst &other, NodeId nodeBase, NodeId linkBase);
+
+	/**
+	* @return the amount of bytes held by the nodes & links.
+	*/
+	size_t BytesUsed() const;
+};
@@ -1,6 +1,80 @@
 #include "Parser.h"
 #include "../tables/VarTable.h"
-#include <stdarg.h>
+#include "../compiler/CompileError.h"
+#include <algorithm>
+#include <deque>
+#include <sstream>
+
+/* TokenType sets the Parser matches against, built at compile time */
+static constexpr TokenSet TYPES = { TokenType::TYPE_VOID, TokenType::TYPE_INT, TokenType::TYPE_FLOAT, TokenType::TYPE_BOOL, TokenType::TYPE_CHAR };
+static constexpr TokenSet LITERALS = { TokenType::INT, TokenType::FLOAT, TokenType::BOOL };
+static constexpr TokenSet UNARY_OPERS = { TokenType::ADD, TokenType::SUB, TokenType::NOT, TokenType::BNOT };
+static constexpr TokenSet ASSIGN_OPERS = {
+	TokenType::EQ, TokenType::EQ_ADD, TokenType::EQ_SUB,
+	TokenType::EQ_MULT, TokenType::EQ_DIV, TokenType::EQ_MOD,
+	TokenType::EQ_POW, TokenType::EQ_BAND, TokenType::EQ_BOR,
+	TokenType::EQ_BNOT, TokenType::EQ_XOR, TokenType::EQ_SHL, TokenType::EQ_SHR };
+static constexpr TokenSet JUMPS = { TokenType::BREAK, TokenType::CONTINUE };
+/* Line starts that don't begin a new top-level statement */
+static constexpr TokenSet LINE_CONTINUATIONS = { TokenType::INDENT, TokenType::ENDL, TokenType::ELIF, TokenType::ELSE };
+
+/**
+* @return the indentation depth of given INDENT Token: its tabs, without any spaces between them.
+*/
+static size_t IndentDepth(const Token &indent)
+{
+	return (size_t) std::count(indent.literal.begin(), indent.literal.end(), '\t');
+}
+
+/* Binding power of a binary oper. Higher powers bind tighter; 0 means the Token isn't a binary oper */
+struct BindingPower
+{
+	uint8_t power;
+	bool rightAssoc;
+};
+
+struct BindingPowerTable
+{
+	BindingPower powers[(size_t) TokenType::INVALID + 1];
+};
+
+static constexpr BindingPowerTable BuildBindingPowers()
+{
+	BindingPowerTable table{};
+
+	/* From loosest to tightest */
+	const TokenSet levels[] =
+	{
+		TokenType::OR,
+		TokenType::AND,
+		{ TokenType::EQEQ, TokenType::NEQ },
+		{ TokenType::GRTR, TokenType::GEQ, TokenType::LESS, TokenType::LEQ },
+		TokenType::BOR,
+		TokenType::BXOR,
+		TokenType::BAND,
+		{ TokenType::SHL, TokenType::SHR },
+		{ TokenType::ADD, TokenType::SUB },
+		{ TokenType::MULT, TokenType::DIV, TokenType::MOD },
+		TokenType::POW,
+	};
+
+	for (size_t level = 0; level < sizeof(levels) / sizeof(levels[0]); level++)
+	{
+		for (size_t type = 0; type <= (size_t) TokenType::INVALID; type++)
+		{
+			if (levels[level].Contains((TokenType) type))
+			{
+				table.powers[type] = BindingPower{ (uint8_t) (level + 1), (TokenType) type == TokenType::POW };
+			}
+		}
+	}
+
+	return table;
+}
+
+static constexpr BindingPowerTable BINDING_POWERS = BuildBindingPowers();
+/* Unary opers apply to POW chains, but not to any looser oper */
+static constexpr uint8_t UNARY_POWER = BINDING_POWERS.powers[(size_t) TokenType::POW].power;
 
 /**
 * Retrieves the Token in the current index.
@@ -8,9 +82,19 @@
 *
 * @return the current Token.
 */
-Token& Parser::Current()
+Token Parser::Current()
+{
+	return tokens.At(index);
+}
+
+/**
+* Retrieves the TokenType of the Token in the current index, without materializing the Token.
+*
+* @return the current TokenType, or INVALID if there's no current Token.
+*/
+TokenType Parser::CurrentType()
 {
-	return tokens[index];
+	return tokens.TypeAt(index);
 }
 
 /**
@@ -36,560 +120,433 @@ void Parser::Prev()
 */
 bool Parser::HasCurrent()
 {
-	return index < tokens.size();
+	return tokens.Has(index);
 }
 
 /**
-* Comapres all given TokenTypes with current Token's TokenType. Returns whether any given TokenType matches.
+* Compares given TokenTypes with current Token's TokenType.
 * Doesn't guarantee that there's a current Token.
 *
-* @param typeCount the amount of given TokenTypes
-* @param ... the desired TokenTypes
-* @return whether current Token's TokenType matches any of the given TokenTypes
+* @param types the desired TokenTypes
+* @return whether current Token's TokenType is in given TokenTypes
 */
-bool Parser::Match(int typeCount, ...)
+bool Parser::Match(TokenSet types)
 {
-	va_list iter;
-	va_start(iter, typeCount);
-
-	TokenType curType = Current().type;
-
-	for (int i = 0; i < typeCount; i++)
-	{
-		TokenType iterType = va_arg(iter, TokenType);
-
-		if (curType == iterType)
-		{
-			return true;
-		}
-	}
-
-	return false;
+	return types.Contains(CurrentType());
 }
 
 bool Parser::IsType()
 {
-	return Match(5, TokenType::TYPE_VOID, TokenType::TYPE_INT, TokenType::TYPE_FLOAT, TokenType::TYPE_BOOL, TokenType::TYPE_CHAR);
+	return Match(TYPES);
 }
 
 /**
-* Checks & returns whether the next Token's TokenType matches any of the given TokenTypes.
-* If there's a match, the Parser advances to the next Token.
-* Doesn't guarantee that there's a next Token.
+* Checks & returns whether the next Token's TokenType is in given TokenTypes.
+* If there's a match, the Parser advances to the next Token. Otherwise, it stays at the current Token.
 *
-* @param typeCount the amount of given TokenTypes
-* @param ... the desired TokenTypes
-* @return whether next Token's TokenType matches any of the given TokenTypes
+* @param types the desired TokenTypes
+* @return whether next Token's TokenType is in given TokenTypes
 */
-bool Parser::MatchNext(int typeCount, ...)
+bool Parser::MatchNext(TokenSet types)
 {
-	Next();
-
-	if (!HasCurrent()) return false;
-
-	va_list iter;
-	va_start(iter, typeCount);
-
-	TokenType curType = Current().type;
-
-	for (int i = 0; i < typeCount; i++)
+	/* Past the end the TokenType is INVALID, which no caller expects, so EOF never matches */
+	if (types.Contains(tokens.TypeAt(index + 1)))
 	{
-		TokenType iterType = va_arg(iter, TokenType);
-
-		if (curType == iterType)
-		{
-			return true;
-		}
+		Next();
+		return true;
 	}
 
-	Prev();
 	return false;
 }
 
 /**
-* Checks whether current Token's TokenType matches any of the given TokenTypes. If there's no match, an 'invalid_argument' exception is thrown.
-* Doesn't guarantee that there's a current Token.
+* Checks whether current Token's TokenType is in given TokenTypes. If there's no match, a CompileError is thrown.
 *
-* @param typeCount the amount of given TokenTypes
-* @param ... the desired TokenTypes
+* @param types the desired TokenTypes
 */
-void Parser::Expect(int typeCount, ...)
+void Parser::Expect(TokenSet types)
 {
 	if (!HasCurrent())
 	{
-		std::cout << "Unexpected EOF.";
-		exit(1);
+		throw CompileError("Unexpected EOF.");
 	}
 
-	va_list iter;
-	va_start(iter, typeCount);
-
-	TokenType curType = Current().type;
-
-	for (int i = 0; i < typeCount; i++)
+	if (!types.Contains(CurrentType()))
 	{
-		TokenType iterType = va_arg(iter, TokenType);
-
-		if (curType == iterType)
-		{
-			return;
-		}
+		std::ostringstream message;
+		message << "Unexpected " << Current() << " Token, index " << index << ".";
+		throw CompileError(message.str());
 	}
-
-	std::cout << "Unexpected " << Current() << " Token, index " << index << ".";
-	exit(1);
 }
 
 bool Parser::HasIndents()
 {
-	if (index + indentCount >= tokens.size()) return false;
+	/* Top level lines have no indentation */
+	if (indentCount == 0) return HasCurrent();
 
-	for (size_t i = index; i < index + indentCount; i++)
-	{
-		if (tokens.at(i).type != TokenType::INDENT) return false;
-	}
+	/* Indents must be followed by the line's first Token */
+	if (!tokens.Has(index + 1)) return false;
 
-	return true;
+	/* Indentation is a single Token, so its depth is known without walking Tokens */
+	return CurrentType() == TokenType::INDENT && IndentDepth(Current()) >= (size_t) indentCount;
 }
 
 void Parser::ExpectIndents()
 {
-	for (int i = 0; i < indentCount; i++)
+	size_t depth = CurrentType() == TokenType::INDENT ? IndentDepth(Current()) : 0;
+
+	if (depth != (size_t) indentCount)
 	{
-		Expect(1, TokenType::INDENT);
-		Next();
+		throw CompileError("Unexpected indentation, index " + std::to_string(index) + ".");
 	}
+
+	if (depth > 0) Next();
 }
 
-Parser::Parser(std::vector<Token> &tokens) :
+Parser::Parser(TokenBuffer &tokens, FlatAst &ast, unsigned int start) :
 	tokens(tokens),
-	index(0),
+	ast(ast),
+	index(start),
 	indentCount(-1)
 {
 }
 
-Expr* Parser::Atom()
+Parser::ExprFrame &Parser::PushFrame(ExprFrame::Kind kind)
 {
-	if (Match(1, TokenType::ID))
-	{
-		Token *id = &Current();
-
-		if (MatchNext(1, TokenType::LS))
-		{
-			Next();
-
-			Expr *index = ValueExpr();
+	exprFrames.push_back(ExprFrame{});
 
-			Next();
-			Expect(1, TokenType::RS);
-
-			return new AccessibleExpr(id, index);
-		}
+	ExprFrame &frame = exprFrames.back();
+	frame.kind = kind;
+	frame.left = NO_NODE;
+	frame.middle = NO_NODE;
 
-		return new AccessibleExpr(id);
-	}
-
-	Expect(3, TokenType::INT, TokenType::FLOAT, TokenType::BOOL);
-	return new LitExpr(&Current());
+	return frame;
 }
 
-Expr* Parser::List()
+void Parser::StartTernary()
 {
-	if (!Match(1, TokenType::LS))
-	{
-		return Atom();
-	}
+	PushFrame(ExprFrame::TERNARY);
+	/* Scan binary opers of any binding power */
+	PushFrame(ExprFrame::BINARY).minPower = 1;
+}
 
-	Next();
+NodeId Parser::AddList(NodeKind kind, size_t start)
+{
+	NodeId list = ast.AddList(kind, pendingNodes.data() + start, pendingNodes.size() - start);
+	pendingNodes.resize(start);
 
-	ArrayExpr *arrayExpr = new ArrayExpr();
+	return list;
+}
 
-	while (true)
+NodeId Parser::StartValue(bool allowInit)
+{
+	if (allowInit && IsType())
 	{
-		if (Match(1, TokenType::RS))
-		{
-			break;
-		}
-
-		arrayExpr->Add(ValueExpr());
-
+		uint32_t type = index;
 		Next();
 
-		if (Match(1, TokenType::COMMA))
+		Expect(TokenType::ID);
+
+		if (!MatchNext(TokenType::EQ))
 		{
 			Next();
+			Expect(TokenType::ENDL);
+			Prev();
+			return ast.Add(NodeKind::INIT, type);
 		}
-	}
-
-	return arrayExpr;
-}
 
-Expr* Parser::Primary()
-{
-	if (Match(1, TokenType::LP))
-	{
-		Next();
-		Expr* value = ValueExpr();
-
-		Next();
-		Expect(1, TokenType::RP);
+		/* Scan the assignment starting from the ID, as any other assignment */
+		Prev();
 
-		return new GroupExpr(value);
+		PushFrame(ExprFrame::INIT).oper = type;
 	}
 
-	return List();
+	PushFrame(ExprFrame::ASSIGN);
+	StartTernary();
+
+	return NO_NODE;
 }
 
-/**
-* On entry: current Token is INT/FLOAT or LPAREN.
-* On exit: current Token is either non-existant or an oper (non-unary).
-* Scans Tokens and returns a matching ValExpr/BinaryExpr of POWER.
-*
-* @return ValExpr/GroupExpr/BinaryExpr of POW
-*/
-Expr* Parser::Power()
+NodeId Parser::ScanOperand()
 {
-	Expr* left = Primary();
-
-	if (MatchNext(1, TokenType::POW))
+	/* Unary opers apply to everything that binds tighter than them (POW), so -a ** b is -(a ** b) */
+	if (Match(UNARY_OPERS))
 	{
-		Token* oper = &Current();
+		PushFrame(ExprFrame::UNARY).oper = index;
+		PushFrame(ExprFrame::BINARY).minPower = UNARY_POWER;
 
 		Next();
-		Expr* right = Factor();
-
-		return new BinaryExpr(left, right, oper);
+		return NO_NODE;
 	}
 
-	return left;
-}
-
-/**
-* On entry: current Token is ADD/SUB or INT/FLOAT.
-* On exit: current Token is either non-existant or an oper (non-unary).
-* Scans Tokens and returns a matching ValExpr/UnaryExpr.
-*
-* @return ValExpr/UnaryExpr
-*/
-Expr* Parser::Factor()
-{
-	if (Match(4, TokenType::ADD, TokenType::SUB, TokenType::NOT, TokenType::BNOT))
+	if (Match(TokenType::LP))
 	{
-		Token* oper = &Current();
+		PushFrame(ExprFrame::GROUP);
 
 		Next();
-		Expr* right = Factor();
-
-		return new UnaryExpr(oper, right);
+		return StartValue(true);
 	}
 
-	return Power();
-}
-
-/**
-* On entry: current Token matches Rank2 entry.
-* On exit: current Token is non-existant or ADD/SUB (non-unary).
-* Scans Tokens and returns a matching BinaryExpr of MULT/DIV.
-*
-* @return BinaryExpr of MULT/DIV
-*/
-Expr* Parser::Term()
-{
-	Expr* left = Factor();
-
-	while (MatchNext(3, TokenType::MULT, TokenType::DIV, TokenType::MOD))
+	if (Match(TokenType::LS))
 	{
-		Token* oper = &Current();
-
 		Next();
 
-		Expr* right = Factor();
+		if (Match(TokenType::RS))
+		{
+			return ast.AddList(NodeKind::ARRAY, NULL, 0);
+		}
 
-		left = new BinaryExpr(left, right, oper);
+		PushFrame(ExprFrame::LIST).listStart = pendingNodes.size();
+		return StartValue(true);
 	}
 
-	return left;
-}
-
-/**
-* On entry: current Token matches Rank1 entry.
-* On exit: current Token is non-existant.
-* Scans Tokens and returns a matching BinaryExpr of ADD/SUB.
-*
-* @return BinaryExpr of ADD/SUB
-*/
-Expr* Parser::Sum()
-{
-	Expr* left = Term();
-
-	while (MatchNext(2, TokenType::ADD, TokenType::SUB))
+	if (Match(TokenType::ID))
 	{
-		Token* oper = &Current();
-
-		Next();
+		uint32_t id = index;
 
-		Expr* right = Term();
-		left = new BinaryExpr(left, right, oper);
-	}
-
-	return left;
-}
-
-Expr* Parser::Shift()
-{
-	Expr* left = Sum();
-
-	while (MatchNext(2, TokenType::SHL, TokenType::SHR))
-	{
-		Token* oper = &Current();
+		if (MatchNext(TokenType::LS))
+		{
+			PushFrame(ExprFrame::INDEX).id = id;
 
-		Next();
+			Next();
+			return StartValue(true);
+		}
 
-		Expr* right = Sum();
-		left = new BinaryExpr(left, right, oper);
+		return ast.Add(NodeKind::ACCESS, id);
 	}
 
-	return left;
+	Expect(LITERALS);
+	return ast.Add(NodeKind::LIT, index);
 }
 
-Expr* Parser::BinaryAnd()
+NodeId Parser::Reduce(NodeId result, size_t base)
 {
-	Expr* left = Shift();
-
-	while (MatchNext(1, TokenType::BAND))
+	while (exprFrames.size() > base)
 	{
-		Token* oper = &Current();
-
-		Next();
-
-		Expr* right = Shift();
-		left = new BinaryExpr(left, right, oper);
-	}
-
-	return left;
-}
+		ExprFrame &frame = exprFrames.back();
 
-Expr* Parser::BinaryXor()
-{
-	Expr* left = BinaryAnd();
-
-	while (MatchNext(1, TokenType::BXOR))
-	{
-		Token* oper = &Current();
+		switch (frame.kind)
+		{
+		case ExprFrame::BINARY:
+		{
+			if (frame.left != NO_NODE)
+			{
+				result = ast.Add(NodeKind::BINARY, frame.oper, frame.left, result);
+			}
 
-		Next();
+			const BindingPower &binding = BINDING_POWERS.powers[(size_t) tokens.TypeAt(index + 1)];
 
-		Expr* right = BinaryAnd();
-		left = new BinaryExpr(left, right, oper);
-	}
+			/* Not a binary oper (power 0), or an oper that binds looser than this frame may consume */
+			if (binding.power == 0 || binding.power < frame.minPower)
+			{
+				exprFrames.pop_back();
+				break;
+			}
 
-	return left;
-}
+			Next();
+			frame.left = result;
+			frame.oper = index;
+			Next();
 
-Expr* Parser::BinaryOr()
-{
-	Expr* left = BinaryXor();
+			/* Right operand only takes opers that bind tighter (or as tight, for right associative opers) */
+			PushFrame(ExprFrame::BINARY).minPower = binding.rightAssoc ? binding.power : binding.power + 1;
+			return NO_NODE;
+		}
 
-	while (MatchNext(1, TokenType::BOR))
-	{
-		Token* oper = &Current();
+		case ExprFrame::UNARY:
+			result = ast.Add(NodeKind::UNARY, frame.oper, result);
+			exprFrames.pop_back();
+			break;
 
-		Next();
+		case ExprFrame::GROUP:
+			exprFrames.pop_back();
 
-		Expr* right = BinaryXor();
-		left = new BinaryExpr(left, right, oper);
-	}
+			Next();
+			Expect(TokenType::RP);
 
-	return left;
-}
+			result = ast.Add(NodeKind::PAREN, 0, result);
+			break;
 
-Expr* Parser::Relation()
-{
-	Expr* left = BinaryOr();
+		case ExprFrame::INDEX:
+			result = ast.Add(NodeKind::ACCESS, frame.id, result);
+			exprFrames.pop_back();
 
-	while (MatchNext(4, TokenType::GRTR, TokenType::GEQ, TokenType::LESS, TokenType::LEQ))
-	{
-		Token* oper = &Current();
+			Next();
+			Expect(TokenType::RS);
+			break;
 
-		Next();
+		case ExprFrame::LIST:
+			pendingNodes.push_back(result);
 
-		Expr* right = BinaryOr();
-		left = new BinaryExpr(left, right, oper);
-	}
+			Next();
 
-	return left;
-}
+			if (Match(TokenType::COMMA))
+			{
+				Next();
+			}
 
-Expr* Parser::Equality()
-{
-	Expr* left = Relation();
+			if (Match(TokenType::RS))
+			{
+				result = AddList(NodeKind::ARRAY, frame.listStart);
+				exprFrames.pop_back();
+				break;
+			}
 
-	while (MatchNext(2, TokenType::EQEQ, TokenType::NEQ))
-	{
-		Token* oper = &Current();
+			/* Scan next element. It's only complete right away if it's an initialization without a value */
+			result = StartValue(true);
+			if (result == NO_NODE) return NO_NODE;
+			break;
 
-		Next();
+		case ExprFrame::TERNARY:
+			if (frame.stage == 0)
+			{
+				if (!MatchNext(TokenType::QMARK))
+				{
+					exprFrames.pop_back();
+					break;
+				}
 
-		Expr* right = Relation();
-		left = new BinaryExpr(left, right, oper);
-	}
+				Next();
+				frame.left = result;
+				frame.stage = 1;
 
-	return left;
-}
+				StartTernary();
+				return NO_NODE;
+			}
 
-Expr* Parser::And()
-{
-	Expr* left = Equality();
+			if (frame.stage == 1)
+			{
+				Next();
+				Expect(TokenType::COLON);
+				Next();
 
-	while (MatchNext(1, TokenType::AND))
-	{
-		Token* oper = &Current();
+				frame.middle = result;
+				frame.stage = 2;
 
-		Next();
+				StartTernary();
+				return NO_NODE;
+			}
 
-		Expr* right = Equality();
-		left = new BinaryExpr(left, right, oper);
-	}
+			result = ast.Add(NodeKind::TERN, 0, frame.left, frame.middle, result);
+			exprFrames.pop_back();
+			break;
 
-	return left;
-}
+		case ExprFrame::ASSIGN:
+			if (frame.stage == 0)
+			{
+				if (!MatchNext(ASSIGN_OPERS))
+				{
+					exprFrames.pop_back();
+					break;
+				}
+
+				/* Only variables can be assigned */
+				Prev();
+				Expect(TokenType::ID);
+				Next();
 
-Expr* Parser::Or()
-{
-	Expr* left = And();
+				frame.left = result;
+				frame.oper = index;
+				frame.stage = 1;
+				Next();
 
-	while (MatchNext(1, TokenType::OR))
-	{
-		Token* oper = &Current();
+				result = StartValue(true);
+				if (result == NO_NODE) return NO_NODE;
+				break;
+			}
 
-		Next();
+			result = ast.Add(NodeKind::ASSIGN, frame.oper, frame.left, result);
+			exprFrames.pop_back();
+			break;
 
-		Expr* right = And();
-		left = new BinaryExpr(left, right, oper);
+		case ExprFrame::INIT:
+			result = ast.Add(NodeKind::INIT, frame.oper, result);
+			exprFrames.pop_back();
+			break;
+		}
 	}
 
-	return left;
+	return result;
 }
 
-Expr* Parser::Ternary()
+NodeId Parser::ScanExpr(bool allowInit)
 {
-	Expr* left = Or();
+	size_t base = exprFrames.size();
+	NodeId result = StartValue(allowInit);
 
-	if (MatchNext(1, TokenType::QMARK))
+	while (true)
 	{
-		Next();
-
-		Expr* e1 = Ternary();
-
-		Next();
-		Expect(1, TokenType::COLON);
-		Next();
+		/* Scan prefixes until an operand is complete */
+		while (result == NO_NODE)
+		{
+			result = ScanOperand();
+		}
 
-		Expr* e2 = Ternary();
+		/* Complete every frame that was waiting for it, until a frame requires another operand */
+		result = Reduce(result, base);
 
-		return new TernExpr(left, e1, e2);
+		if (result != NO_NODE) return result;
 	}
-
-	return left;
 }
 
-Expr *Parser::Assign()
+NodeId Parser::Assign()
 {
-	Expr *left = Ternary();
-
-	if (MatchNext(13, TokenType::EQ, TokenType::EQ_ADD, TokenType::EQ_SUB,
-		TokenType::EQ_MULT, TokenType::EQ_DIV, TokenType::EQ_MOD,
-		TokenType::EQ_POW, TokenType::EQ_BAND, TokenType::EQ_BOR,
-		TokenType::EQ_BNOT, TokenType::EQ_XOR, TokenType::EQ_SHL, TokenType::EQ_SHR))
-	{
-		Prev();
-		Expect(1, TokenType::ID);
-		Next();
-
-		Token *assignOper = &Current();
-		Next();
-
-		Expr *value = ValueExpr();
-		left = new AssignExpr((AccessibleExpr *) left, assignOper, value);
-	}
-
-	return left;
+	return ScanExpr(false);
 }
 
-Expr *Parser::Init()
+NodeId Parser::Init()
 {
-	if (!IsType())
-	{
-		return Assign();
-	}
-
-	Token *type = &Current();
-	Next();
-
-	Expect(1, TokenType::ID);
-	Token *id = &Current();
-	
-	if (!MatchNext(1, TokenType::EQ))
-	{
-		Next();
-		Expect(1, TokenType::ENDL);
-		Prev();
-		return new InitExpr(type, id);
-	}
-
-	Prev();
-	return new InitExpr(type, id, (AssignExpr *) Assign());
+	return ScanExpr(true);
 }
 
-Expr *Parser::ValueExpr()
+NodeId Parser::ValueExpr()
 {
 	return Init();
 }
 
-Expr* Parser::Print()
+NodeId Parser::Print()
 {
-	if (Match(1, TokenType::PRINT))
+	if (Match(TokenType::PRINT))
 	{
 		Next();
-		Expect(1, TokenType::LP);
+		Expect(TokenType::LP);
 		Next();
 
-		Expr* value = ValueExpr();
+		NodeId value = ValueExpr();
 
 		Next();
-		Expect(1, TokenType::RP);
+		Expect(TokenType::RP);
 
-		return new PrintExpr(value);
+		return ast.Add(NodeKind::PRINT, 0, value);
 	}
 
 	return Init();
 }
 
-IfExpr* Parser::If()
+void Parser::If()
 {
 	Next();
 
-	CondExpr *cond = new CondExpr(ValueExpr());
+	pendingNodes.push_back(ast.Add(NodeKind::COND, 0, ValueExpr()));
 
 	Next();
-	Expect(1, TokenType::ENDL);
+	Expect(TokenType::ENDL);
 	Next();
 
-	ExprGroup *block = DeepCodeBlock();
-
-	return new IfExpr(cond, block);
+	NodeId block = DeepCodeBlock();
+	pendingNodes.push_back(block);
 }
 
-IfExpr* Parser::Elif()
+NodeId Parser::Elif()
 {
-	IfExpr* ifExpr = If();
+	/* Conditions & blocks of the chain, in pairs */
+	size_t start = pendingNodes.size();
+
+	If();
 
 	/* Keep track of the ending of last found IfExpr */
 	int ifEnd = index;
 
-	/* Used to iterate over IfExpr and construct elif chain */
-	IfExpr* iter = ifExpr;
-
 	while (true)
 	{
 		/* Move to (expected) EOL from last Token of IfExpr */
@@ -597,7 +554,7 @@ IfExpr* Parser::Elif()
 		/* If no EOL, assume EOF and exit */
 		if (!HasCurrent()) break;
 		/* Expect EOL */
-		Expect(1, TokenType::ENDL);
+		Expect(TokenType::ENDL);
 		/* Move to next statement */
 		Next();
 		/* If there isn't engouh indentation, there will be no ELIF */
@@ -606,13 +563,10 @@ IfExpr* Parser::Elif()
 		ExpectIndents();
 
 		/* Check if current Token is ELIF */
-		if (!Match(1, TokenType::ELIF)) break;
+		if (!Match(TokenType::ELIF)) break;
 
 		/* Scan ELIF as if it were IF (same Exprs, different compiling methods) */
-		IfExpr* elif = If();
-		/* Add expr to elif chain & advance iter */
-		iter->elif = elif;
-		iter = iter->elif;
+		If();
 		/* Update ending of last found IfExpr */
 		ifEnd = index;
 	}
@@ -621,18 +575,28 @@ IfExpr* Parser::Elif()
 	/* This is required as we aren't guaranteed to find ELIF, yet we skip Tokens to find it. */
 	index = ifEnd;
 
-	return ifExpr;
+	/* Build the chain from its end, so every IfExpr node comes after its elif */
+	NodeId elif = NO_NODE;
+
+	for (size_t i = pendingNodes.size(); i > start; i -= 2)
+	{
+		elif = ast.Add(NodeKind::IF, 0, pendingNodes[i - 2], pendingNodes[i - 1], elif);
+	}
+
+	pendingNodes.resize(start);
+
+	return elif;
 }
 
-Expr* Parser::Else()
+NodeId Parser::Else()
 {
-	if (!Match(1, TokenType::IF))
+	if (!Match(TokenType::IF))
 	{
 		return Print();
 	}
 
 	/* Scan if/elif chain */
-	IfExpr* ifExpr = Elif();
+	NodeId ifExpr = Elif();
 
 	int backup = index;
 
@@ -642,7 +606,7 @@ Expr* Parser::Else()
 	if (HasCurrent())
 	{
 		/* Expect EOL */
-		Expect(1, TokenType::ENDL);
+		Expect(TokenType::ENDL);
 		/* Move to next statement */
 		Next();
 		/* If there isn't engouh indentation, there will be no ELIF */
@@ -651,15 +615,15 @@ Expr* Parser::Else()
 			/* Expect the indentation */
 			ExpectIndents();
 
-			if (Match(1, TokenType::ELSE))
+			if (Match(TokenType::ELSE))
 			{
 				Next();
-				Expect(1, TokenType::ENDL);
+				Expect(TokenType::ENDL);
 				Next();
 
-				ExprGroup * ifElse = DeepCodeBlock();
+				NodeId ifElse = DeepCodeBlock();
 
-				return new ElseExpr(ifExpr, ifElse);
+				return ast.Add(NodeKind::ELSE, 0, ifExpr, ifElse);
 			}
 		}
 	}
@@ -668,108 +632,109 @@ Expr* Parser::Else()
 	return ifExpr;
 }
 
-Expr* Parser::Jump()
+NodeId Parser::Jump()
 {
-	if (!Match(2, TokenType::BREAK, TokenType::CONTINUE))
+	if (!Match(JUMPS))
 	{
 		return Else();
 	}
 
-	return new ControlFlowExpr(&Current());
+	return ast.Add(NodeKind::CONTROL_FLOW, index);
 }
 
-Expr* Parser::While()
+NodeId Parser::While()
 {
-	if (!Match(1, TokenType::WHILE))
+	if (!Match(TokenType::WHILE))
 	{
 		return Jump();
 	}
 
 	Next();
 
-	CondExpr* cond = new CondExpr(ValueExpr());
+	NodeId cond = ast.Add(NodeKind::COND, 0, ValueExpr());
 
 	Next();
-	Expect(1, TokenType::ENDL);
+	Expect(TokenType::ENDL);
 	Next();
 
-	ExprGroup * block = DeepCodeBlock();
+	NodeId block = DeepCodeBlock();
 
-	return new WhileExpr(cond, block);
+	return ast.Add(NodeKind::WHILE, 0, cond, block);
 }
 
-Expr* Parser::For()
+NodeId Parser::For()
 {
-	if (!Match(1, TokenType::FOR))
+	if (!Match(TokenType::FOR))
 	{
 		return While();
 	}
 
 	Next();
-	Expr* assign = Init();
+	NodeId assign = Init();
 	Next();
-	Expect(1, TokenType::COMMA);
+	Expect(TokenType::COMMA);
 	Next();
 
-	CondExpr* cond = new CondExpr(ValueExpr());
+	NodeId cond = ast.Add(NodeKind::COND, 0, ValueExpr());
 	Next();
-	Expect(1, TokenType::COMMA);
+	Expect(TokenType::COMMA);
 	Next();
 
-	Expr* incr = Assign();
+	NodeId incr = Assign();
 	Next();
-	Expect(1, TokenType::ENDL);
+	Expect(TokenType::ENDL);
 	Next();
 
-	ExprGroup * block = DeepCodeBlock();
+	NodeId block = DeepCodeBlock();
 
-	return new ForExpr(assign, cond, incr, block);
+	NodeId children[] = { assign, cond, incr, block };
+	return ast.AddList(NodeKind::FOR, children, 4);
 }
 
 // Not being used currently
-Expr *Parser::Func()
+NodeId Parser::Func()
 {
 	if (!IsType())
 	{
 		return For();
 	}
 
-	Token *type = &Current();
+	uint32_t type = index;
 	Next();
 
-	Expect(1, TokenType::ID);
-	Token *id = &Current();
+	Expect(TokenType::ID);
 	Next();
 
-	if (!Match(1, TokenType::LP))
+	if (!Match(TokenType::LP))
 	{
 		Prev(); Prev(); // Go back to type
 		return Init();
 	}
 
-	Expect(1, TokenType::LP);
+	Expect(TokenType::LP);
 	Next();
-	Expect(1, TokenType::RP);
+	Expect(TokenType::RP);
 	Next();
 
-	Expect(1, TokenType::ENDL);
+	Expect(TokenType::ENDL);
 	Next();
 
-	ExprGroup *body = DeepCodeBlock();
+	NodeId body = DeepCodeBlock();
 
-	return new FuncExpr(type, id, body);
+	return ast.Add(NodeKind::FUNC, type, body);
 }
 
-Expr* Parser::Statement()
+NodeId Parser::Statement()
 {
 	return Func();
 }
 
-ExprGroup* Parser::DeepCodeBlock()
+NodeId Parser::DeepCodeBlock()
 {
  	indentCount++;
 
-	ExprGroup* block = new ExprGroup();
+	/* The block's statements are collected until it ends, since nested blocks add their own statements in between */
+	size_t start = pendingNodes.size();
 
 	while (HasCurrent())
 	{
@@ -781,28 +746,161 @@ ExprGroup* Parser::DeepCodeBlock()
 
 		ExpectIndents();
 
-		if (Match(1, TokenType::ENDL))
+		if (Match(TokenType::ENDL))
 		{
 			Next();
 			continue;
 		}
 
-		block->Add(Statement());
+		NodeId statement = Statement();
+		pendingNodes.push_back(statement);
 		Next();
 
 		if (!HasCurrent()) break;
 
-		Expect(1, TokenType::ENDL);
+		Expect(TokenType::ENDL);
 		Next();
 	}
 
 	indentCount--;
 
-	return block;
+	return AddList(NodeKind::GROUP, start);
 }
 
-ExprGroup* ParseExprs(std::vector<Token>& tokens)
+/* Smallest chunk worth parsing on its own thread, in Tokens */
+static const size_t MIN_CHUNK_TOKENS = 32 * 1024;
+/* Chunks per worker, so workers that finish simple chunks early pick up more */
+static const size_t CHUNKS_PER_WORKER = 4;
+
+/**
+* @return whether a top-level statement starts at given Token, which must be available.
+*/
+static bool StartsTopLevel(TokenBuffer &tokens, size_t index)
 {
-	Parser parser(tokens);
-	return parser.DeepCodeBlock();
+	return tokens.TypeAt(index - 1) == TokenType::ENDL && !LINE_CONTINUATIONS.Contains(tokens.TypeAt(index));
 }
+
+std::vector<size_t> SplitTopLevel(TokenBuffer &tokens, size_t chunkSize)
+{
+	std::vector<size_t> starts{ 0 };
+	size_t size = tokens.Size();
+
+	for (size_t i = chunkSize; i < size; i++)
+	{
+		if (StartsTopLevel(tokens, i))
+		{
+			starts.push_back(i);
+			i += chunkSize - 1;
+		}
+	}
+
+	starts.push_back(size);
+	return starts;
+}
+
+NodeId ParseChunk(TokenBuffer &tokens, FlatAst &ast, size_t start, size_t end)
+{
+	/* The chunk ends like a whole program does, so its Parser sees the end of the chunk as EOF */
+	TokenBuffer view(tokens, end);
+	Parser parser(view, ast, (unsigned int) start);
+
+	ast.root = parser.DeepCodeBlock();
+	return ast.root;
+}
+
+NodeId ParseExprs(TokenBuffer &tokens, FlatAst &ast, ThreadPool *pool)
+{
+	/* A single worker can't parse chunks in parallel, so splitting would only add work */
+	if (pool == NULL || pool->WorkerCount() <= 1)
+	{
+		Parser parser(tokens, ast);
+		ast.root = parser.DeepCodeBlock();
+
+		return ast.root;
+	}
+
+	/* A streamed program's size is only known once it ends, so its chunks are the smallest ones worth parsing on their own */
+	size_t chunkSize = tokens.Streaming() ? MIN_CHUNK_TOKENS : std::max(MIN_CHUNK_TOKENS, tokens.Size() / (pool->WorkerCount() * CHUNKS_PER_WORKER));
+
+	/* Deques, so submitted chunks & their views never move while more are added */
+	std::deque<FlatAst> chunks;
+	std::deque<TokenBuffer> views;
+	std::vector<size_t> starts{ 0 };
+
+	/* A chunk is submitted as soon as its Tokens arrived, so a streamed program is parsed while the rest of it is scanned */
+	auto Submit = [&](size_t end)
+	{
+		size_t start = starts.back();
+		FlatAst &chunk = chunks.emplace_back();
+		/* The view is created on this thread, since the buffer keeps growing here while chunks are parsed */
+		TokenBuffer &view = views.emplace_back(tokens, end);
+
+		pool->Submit([&view, &chunk, start, end]
+		{
+			ParseChunk(view, chunk, start, end);
+		});
+
+		starts.push_back(end);
+	};
+
+	for (size_t i = chunkSize; tokens.Has(i); i++)
+	{
+		if (StartsTopLevel(tokens, i))
+		{
+			Submit(i);
+			i += chunkSize - 1;
+		}
+	}
+
+	/* The whole program is a single chunk */
+	if (chunks.empty())
+	{
+		Parser parser(tokens, ast);
+		ast.root = parser.DeepCodeBlock();
+
+		return ast.root;
+	}
+
+	Submit(tokens.Size());
+	pool->Wait();
+
+	size_t chunkCount = chunks.size();
+
+	/* Place the chunks one after the other, without their root blocks, and join their statements in source order */
+	std::vector<NodeId> nodeBases(chunkCount), linkBases(chunkCount), statements;
+	size_t nodeCount = 0, linkCount = 0;
+
+	for (size_t i = 0; i < chunkCount; i++)
+	{
+		const FlatAst &chunk = chunks[i];
+		const FlatNode &root = chunk[chunk.root];
+
+		nodeBases[i] = (NodeId) nodeCount;
+		linkBases[i] = (NodeId) linkCount;
+
+		for (NodeId j = 0; j < root.b; j++)
+		{
+			statements.push_back(chunk.links[root.a + j] + nodeBases[i]);
+		}
+
+		nodeCount += chunk.root;
+		linkCount += root.a;
+	}
+
+	ast.nodes.resize(nodeCount);
+	ast.links.resize(linkCount);
+
+	for (size_t i = 0; i < chunkCount; i++)
+	{
+		pool->Submit([&ast, &chunks, &nodeBases, &linkBases, i]
+		{
+			ast.CopyBlock(chunks[i], nodeBases[i], linkBases[i]);
+		});
+	}
+
+	pool->Wait();
+
+	ast.root = ast.AddList(NodeKind::GROUP, statements.data(), statements.size());
+
+	return ast.root;
+}
\ No newline at end of file
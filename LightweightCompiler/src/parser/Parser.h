@@ -1,13 +1,56 @@
 #pragma once
 #include "../tokens/Token.h"
-#include "Expr.h"
+#include "../tokens/TokenBuffer.h"
+#include "../tokens/TokenSet.h"
+#include "FlatAst.h"
+#include "../util/ThreadPool.h"
 
 class Parser
 {
 private:
-	std::vector<Token> &tokens;
+	/**
+	* Construct of a value expression that's waiting for its next sub-expression.
+	* Value expressions are scanned without recursion: instead of a nested call, every construct that contains a sub-expression
+	* pushes a frame, and the frame is completed once its sub-expression was scanned. Nesting depth therefore costs frames, not native stack.
+	*/
+	struct ExprFrame
+	{
+		enum Kind : uint8_t
+		{
+			INIT, // type id = <value>
+			ASSIGN, // <ternary> [assignOper <value>]
+			TERNARY, // <binary> [? <ternary> : <ternary>]
+			BINARY, // <operand> {oper <operand>}, for opers that bind at least as tight as minPower
+			UNARY, // oper <binary of UNARY_POWER>
+			GROUP, // ( <value> )
+			INDEX, // id [ <value> ]
+			LIST, // [ <value>, ... ]
+		};
+
+		Kind kind;
+		/* How many of the construct's sub-expressions were scanned (ASSIGN/TERNARY) */
+		uint8_t stage;
+		/* Loosest binding power the frame may consume (BINARY) */
+		uint8_t minPower;
+		/* Token index of the construct's oper (ASSIGN/BINARY/UNARY), or of the declared type (INIT) */
+		uint32_t oper;
+		/* Token index of the accessed variable (INDEX) */
+		uint32_t id;
+		/* Sub-expressions scanned so far: left operand (ASSIGN/BINARY) or condition & true case (TERNARY) */
+		NodeId left, middle;
+		/* Where the array's scanned values start in pendingNodes (LIST) */
+		size_t listStart;
+	};
+
+	TokenBuffer &tokens;
+	/* AST that receives every node scanned by this Parser */
+	FlatAst &ast;
 	unsigned int index;
 	int indentCount;
+	/* Frames of the value expression being scanned. Kept between expressions to reuse its storage */
+	std::vector<ExprFrame> exprFrames;
+	/* Children of the arrays & blocks that are still being scanned, innermost last. Nodes of a list are added once the list is complete */
+	std::vector<NodeId> pendingNodes;
 
 	/**
 	* Retrieves the Token in the current index.
@@ -15,7 +58,13 @@ private:
 	*
 	* @return the current Token.
 	*/
-	Token &Current();
+	Token Current();
+	/**
+	* Retrieves the TokenType of the Token in the current index, without materializing the Token.
+	*
+	* @return the current TokenType, or INVALID if there's no current Token.
+	*/
+	TokenType CurrentType();
 	/**
 	* Progress to next Token by incrementing the index.
 	*/
@@ -31,100 +80,133 @@ private:
 	*/
 	bool HasCurrent();
 	/**
-	* Comapres all given TokenTypes with current Token's TokenType. Returns whether any given TokenType matches.
+	* Compares given TokenTypes with current Token's TokenType.
 	* Doesn't guarantee that there's a current Token.
 	*
-	* @param typeCount the amount of given TokenTypes
-	* @param ... the desired TokenTypes
-	* @return whether current Token's TokenType matches any of the given TokenTypes
+	* @param types the desired TokenTypes
+	* @return whether current Token's TokenType is in given TokenTypes
 	*/
-	bool Match(int typeCount, ...);
+	bool Match(TokenSet types);
 	/**
 	* Check whether current Token is a Type Token (TYPE_VOID, TYPE_INT, etc)
 	*/
 	bool IsType();
 	/**
-	* Checks & returns whether the next Token's TokenType matches any of the given TokenTypes.
-	* If there's a match, the Parser advances to the next Token.
-	* Doesn't guarantee that there's a next Token.
+	* Checks & returns whether the next Token's TokenType is in given TokenTypes.
+	* If there's a match, the Parser advances to the next Token. Otherwise, it stays at the current Token.
 	*
-	* @param typeCount the amount of given TokenTypes
-	* @param ... the desired TokenTypes
-	* @return whether next Token's TokenType matches any of the given TokenTypes
+	* @param types the desired TokenTypes
+	* @return whether next Token's TokenType is in given TokenTypes
 	*/
-	bool MatchNext(int typeCount, ...);
+	bool MatchNext(TokenSet types);
 	/**
-	* Checks whether current Token's TokenType matches any of the given TokenTypes. If there's no match, an 'invalid_argument' exception is thrown.
-	* Doesn't guarantee that there's a current Token.
+	* Checks whether current Token's TokenType is in given TokenTypes. If there's no match, compilation stops with an error.
 	*
-	* @param typeCount the amount of given TokenTypes
-	* @param ... the desired TokenTypes
+	* @param types the desired TokenTypes
 	*/
-	void Expect(int typeCount, ...);
+	void Expect(TokenSet types);
 	bool HasIndents();
 	void ExpectIndents();
 
-public:
-	Parser(std::vector<Token> &tokens);
-
-	Expr *Atom();
-	Expr *List();
-	Expr *Primary();
 	/**
-	* On entry: current Token is INT/FLOAT or LPAREN.
-	* On exit: current Token is either non-existant or an oper (non-unary).
-	* Scans Tokens and returns a matching ValExpr/BinaryExpr of POWER.
+	* Pushes a new frame of given kind, with all other fields cleared.
+	*
+	* @return the new frame. Valid until the next frame is pushed.
+	*/
+	ExprFrame &PushFrame(ExprFrame::Kind kind);
+	/**
+	* Pushes the frames that scan a ternary expression (the loosest expression that isn't an assignment).
+	*/
+	void StartTernary();
+	/**
+	* Adds a list node whose children are the pending nodes from given start, and removes them from pendingNodes.
+	*
+	* @return the new node's NodeId.
+	*/
+	NodeId AddList(NodeKind kind, size_t start);
+	/**
+	* Starts scanning a value expression at the current Token.
 	*
-	* @return ValExpr/GroupExpr/BinaryExpr of POW
+	* @param allowInit whether the value may be a variable initialization.
+	* @return the scanned expression if it was completed right away (an initialization without a value), and NO_NODE if frames were pushed for it.
 	*/
-	Expr *Power();
+	NodeId StartValue(bool allowInit);
 	/**
-	* On entry: current Token is ADD/SUB or INT/FLOAT.
-	* On exit: current Token is either non-existant or an oper (non-unary).
-	* Scans Tokens and returns a matching ValExpr/UnaryExpr.
+	* Scans the operand at the current Token. Prefixes (unary opers, brackets, index accessors) push frames & move on to the next operand.
 	*
-	* @return ValExpr/UnaryExpr
+	* @return the scanned operand, or NO_NODE if a prefix was scanned & another operand is required.
 	*/
-	Expr *Factor();
+	NodeId ScanOperand();
 	/**
-	* On entry: current Token matches Rank2 entry.
-	* On exit: current Token is non-existant or ADD/SUB (non-unary).
-	* Scans Tokens and returns a matching BinaryExpr of MULT/DIV.
+	* Completes the frames above given base with given complete sub-expression, until a frame requires another sub-expression.
 	*
-	* @return BinaryExpr of MULT/DIV
+	* @param result the sub-expression that was just completed.
+	* @param base the amount of frames that aren't part of the current expression.
+	* @return the complete expression once all frames above base are completed, or NO_NODE if another operand is required.
 	*/
-	Expr *Term();
+	NodeId Reduce(NodeId result, size_t base);
 	/**
-	* On entry: current Token matches Rank1 entry.
-	* On exit: current Token is non-existant.
-	* Scans Tokens and returns a matching BinaryExpr of ADD/SUB.
+	* On entry: current Token is the first Token of the expression.
+	* On exit: current Token is the last Token of the expression.
+	* Scans a whole value expression with an explicit stack of frames, in native stack space that doesn't depend on the expression's depth.
 	*
-	* @return BinaryExpr of ADD/SUB
-	*/
-	Expr *Sum();
-	Expr *Shift();
-	Expr *BinaryAnd();
-	Expr *BinaryXor();
-	Expr *BinaryOr();
-	Expr *Relation();
-	Expr *Equality();
-	Expr *And();
-	Expr *Or();
-	Expr *Ternary();
-	Expr *ValueExpr();
-	Expr *Assign();
-	Expr *Init();
-	Expr *Print();
-	IfExpr *If();
-	IfExpr *Elif();
-	Expr *Else();
-	Expr *Jump();
-	Expr *While();
-	Expr *For();
-	Expr *Func();
-	Expr *Statement();
+	* @param allowInit whether the expression may be a variable initialization.
+	* @return the scanned expression.
+	*/
+	NodeId ScanExpr(bool allowInit);
+
+public:
+	/**
+	* @param start index of the first Token to parse.
+	*/
+	Parser(TokenBuffer &tokens, FlatAst &ast, unsigned int start = 0);
 
-	ExprGroup *DeepCodeBlock();
+	NodeId ValueExpr();
+	NodeId Assign();
+	NodeId Init();
+	NodeId Print();
+	/**
+	* Scans an if/elif branch, and pushes its condition & block to pendingNodes. The chain's nodes are added by Elif once it's complete.
+	*/
+	void If();
+	NodeId Elif();
+	NodeId Else();
+	NodeId Jump();
+	NodeId While();
+	NodeId For();
+	NodeId Func();
+	NodeId Statement();
+
+	NodeId DeepCodeBlock();
 };
 
-ExprGroup *ParseExprs(std::vector<Token>& tokens);
+/**
+* Splits the Tokens into chunks of whole top-level statements. Every Token must be available (see TokenBuffer::Fill).
+* A top-level statement starts right after an ENDL, at a line without indentation, unless the line continues an if chain (ELIF/ELSE).
+*
+* @param chunkSize the least amount of Tokens in a chunk (except for the last one). With 1, every top-level statement is a chunk.
+* @return the first Token of every chunk, followed by the amount of Tokens.
+*/
+std::vector<size_t> SplitTopLevel(TokenBuffer &tokens, size_t chunkSize);
+
+/**
+* Parses a chunk of whole top-level statements on its own, as if it were the whole program. Can run in parallel with other chunks of the same Tokens.
+*
+* @param start the chunk's first Token.
+* @param end the Token after the chunk's last.
+* @param ast the FlatAst that receives the chunk's nodes. Its root is set to the chunk's top-level block.
+* @return the chunk's top-level block.
+*/
+NodeId ParseChunk(TokenBuffer &tokens, FlatAst &ast, size_t start, size_t end);
+
+/**
+* With a ThreadPool, large programs are split between top-level statements into chunks that are parsed in parallel,
+* and the chunks' statements are joined back in source order. The result is the same as parsing serially.
+* Tokens still arriving from a stream are split as they arrive, so chunks are parsed while the rest of the source is scanned.
+*
+* @param tokens the Tokens to parse.
+* @param ast the FlatAst that receives the parsed nodes. Its root is set to the top-level block.
+* @param pool the workers that parse the chunks, or NULL to parse serially.
+* @return the top-level block of the program.
+*/
+NodeId ParseExprs(TokenBuffer &tokens, FlatAst &ast, ThreadPool *pool = NULL);
@@ -30,21 +30,29 @@ const Type *TypeTable::GetType(const Token *type)
 	return NULL;
 }
 
-size_t VarTable::totalBytes = 0;
-
-VarTable::VarTable()
+VarTable::VarTable(Arena *arena, size_t *totalBytes) :
+	totalBytes(totalBytes),
+	arena(arena),
+	varMap(VarMap(ArenaAllocator<VarMap::value_type>(arena)))
 {
-	this->varMap = std::unordered_map<std::string, Var*>();
 }
 
 Var *VarTable::Add(const Token *id, const Type *type)
 {
 	if (varMap[id->literal] != NULL) return NULL;
 
-	Var *var = new Var(id, type, totalBytes + type->size);
+	Var *var = arena->New<Var>(id->literal, type, *totalBytes + type->size);
+
+	*totalBytes += type->size;
+	varMap[var->id] = var;
+
+	return var;
+}
 
-	totalBytes += type->size;
-	varMap[var->id->literal] = var;
+Var *VarTable::Import(VarId id, const Type *type, size_t declaration)
+{
+	Var *var = arena->New<Var>(id, type, 0, declaration);
+	varMap[id] = var;
 
 	return var;
 }
@@ -1,5 +1,8 @@
 #pragma once
 #include "../tokens/Token.h"
+#include "../util/Arena.h"
+#include "../asm/ASMInstruction.h"
+#include <cstdint>
 #include <unordered_map>
 
 struct Type
@@ -17,7 +20,8 @@ struct Type
 	}
 };
 
-using VarId = std::string;
+/* Variables are keyed by their ID Token's literal, which views the source buffer */
+using VarId = std::string_view;
 
 class TypeTable
 {
@@ -38,26 +42,50 @@ public:
 
 struct Var
 {
-	const Token *id;
+	/* Declaration value of variables that weren't imported */
+	static const size_t NOT_IMPORTED = SIZE_MAX;
+	/* Register value of variables that are in their stack memory */
+	static const ASMReg IN_MEMORY = ASMReg::ESP;
+
+	const VarId id;
 	const Type *type;
 	const size_t memOffset;
+	/* Position of the variable in its chunk's imports, when top-level statements are compiled in separate chunks */
+	const size_t declaration;
+	/* Register that holds the variable while a loop that uses it runs, so its memory is only up to date outside of the loop */
+	ASMReg reg;
 
-	Var(const Token *id, const Type *type, size_t memOffset) :
+	Var(VarId id, const Type *type, size_t memOffset, size_t declaration = NOT_IMPORTED) :
 		id(id),
 		type(type),
-		memOffset(memOffset)
+		memOffset(memOffset),
+		declaration(declaration),
+		reg(IN_MEMORY)
 	{
 	}
 };
 
+/* Map of variables that takes its nodes from the compilation's Arena */
+using VarMap = std::unordered_map<VarId, Var *, std::hash<VarId>, std::equal_to<VarId>, ArenaAllocator<std::pair<const VarId, Var *>>>;
+
 class VarTable
 {
 private:
-	static size_t totalBytes;
-	std::unordered_map<VarId, Var *> varMap;
+	/* Stack bytes allocated for variables so far, shared by every VarTable of the same code */
+	size_t *totalBytes;
+	/* Arena that owns this table's Vars */
+	Arena *arena;
+	VarMap varMap;
 
 public:
-	VarTable();
+	VarTable(Arena *arena, size_t *totalBytes);
 	Var *Add(const Token *id, const Type *type);
+	/**
+	* Adds a variable that was declared by code compiled separately. It takes no stack bytes from this table's code.
+	*
+	* @param declaration position of the variable in the importing chunk's imports.
+	* @return the new variable.
+	*/
+	Var *Import(VarId id, const Type *type, size_t declaration);
 	Var *Get(const Token *id);
 };
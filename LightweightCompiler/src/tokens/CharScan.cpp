@@ -0,0 +1,221 @@
+#include "CharScan.h"
+
+#if defined(_M_X64) || defined(__x86_64__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2) || defined(__SSE2__)
+#define CHARSCAN_X86
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+#define CHARSCAN_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define CHARSCAN_TARGET_AVX2
+#endif
+
+/* Signature shared by all kernels: (chars, index, length) -> index of the first char that ends the run */
+using ScanKernel = size_t (*)(const char *, size_t, size_t);
+
+static bool IsSpace(char ch)
+{
+	return ch == ' ' || ch == '\r' || ch == '\v' || ch == '\f';
+}
+
+static bool IsDigit(char ch)
+{
+	return ch >= '0' && ch <= '9';
+}
+
+static bool IsAlnum(char ch)
+{
+	return IsDigit(ch) || (ch >= 'a' && ch <= 'z') || (ch >= 'A' && ch <= 'Z');
+}
+
+static size_t SkipSpacesScalar(const char *chars, size_t index, size_t length)
+{
+	while (index < length && IsSpace(chars[index])) index++;
+	return index;
+}
+
+static size_t SkipAlnumScalar(const char *chars, size_t index, size_t length)
+{
+	while (index < length && IsAlnum(chars[index])) index++;
+	return index;
+}
+
+static size_t SkipDigitsScalar(const char *chars, size_t index, size_t length)
+{
+	while (index < length && IsDigit(chars[index])) index++;
+	return index;
+}
+
+#ifdef CHARSCAN_X86
+
+/**
+* @return index of the lowest set bit in given non-zero mask.
+*/
+static unsigned LowestBit(unsigned mask)
+{
+#ifdef _MSC_VER
+	unsigned long bit;
+	_BitScanForward(&bit, mask);
+	return bit;
+#else
+	return __builtin_ctz(mask);
+#endif
+}
+
+/* Marks every byte of chars that lies in [low, low + count). Comparisons are signed, so the range is shifted around -128 */
+static __m128i InRange128(__m128i chars, char low, int count)
+{
+	__m128i shifted = _mm_xor_si128(_mm_sub_epi8(chars, _mm_set1_epi8(low)), _mm_set1_epi8((char) 0x80));
+	return _mm_cmplt_epi8(shifted, _mm_set1_epi8((char) (count ^ 0x80)));
+}
+
+static __m128i Spaces128(__m128i chars)
+{
+	__m128i space = _mm_cmpeq_epi8(chars, _mm_set1_epi8(' '));
+	__m128i carriage = _mm_cmpeq_epi8(chars, _mm_set1_epi8('\r'));
+	return _mm_or_si128(_mm_or_si128(space, carriage), InRange128(chars, '\v', 2));
+}
+
+static __m128i Digits128(__m128i chars)
+{
+	return InRange128(chars, '0', 10);
+}
+
+static __m128i Alnum128(__m128i chars)
+{
+	/* Setting bit 5 maps upper case letters to lower case, and no other char into the letter range */
+	__m128i letters = InRange128(_mm_or_si128(chars, _mm_set1_epi8(0x20)), 'a', 26);
+	return _mm_or_si128(letters, Digits128(chars));
+}
+
+/* Defines an SSE2 kernel that skips 16 chars at a time while all of them match, then finishes with the scalar kernel */
+#define CHARSCAN_SSE2_KERNEL(name, classify, scalar) \
+	static size_t name(const char *chars, size_t index, size_t length) \
+	{ \
+		while (index + 16 <= length) \
+		{ \
+			__m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i *>(chars + index)); \
+			unsigned mismatches = ~(unsigned) _mm_movemask_epi8(classify(block)) & 0xFFFF; \
+			if (mismatches != 0) return index + LowestBit(mismatches); \
+			index += 16; \
+		} \
+		return scalar(chars, index, length); \
+	}
+
+CHARSCAN_SSE2_KERNEL(SkipSpacesSSE2, Spaces128, SkipSpacesScalar)
+CHARSCAN_SSE2_KERNEL(SkipAlnumSSE2, Alnum128, SkipAlnumScalar)
+CHARSCAN_SSE2_KERNEL(SkipDigitsSSE2, Digits128, SkipDigitsScalar)
+
+CHARSCAN_TARGET_AVX2 static __m256i InRange256(__m256i chars, char low, int count)
+{
+	__m256i shifted = _mm256_xor_si256(_mm256_sub_epi8(chars, _mm256_set1_epi8(low)), _mm256_set1_epi8((char) 0x80));
+	return _mm256_cmpgt_epi8(_mm256_set1_epi8((char) (count ^ 0x80)), shifted);
+}
+
+CHARSCAN_TARGET_AVX2 static __m256i Spaces256(__m256i chars)
+{
+	__m256i space = _mm256_cmpeq_epi8(chars, _mm256_set1_epi8(' '));
+	__m256i carriage = _mm256_cmpeq_epi8(chars, _mm256_set1_epi8('\r'));
+	return _mm256_or_si256(_mm256_or_si256(space, carriage), InRange256(chars, '\v', 2));
+}
+
+CHARSCAN_TARGET_AVX2 static __m256i Digits256(__m256i chars)
+{
+	return InRange256(chars, '0', 10);
+}
+
+CHARSCAN_TARGET_AVX2 static __m256i Alnum256(__m256i chars)
+{
+	__m256i letters = InRange256(_mm256_or_si256(chars, _mm256_set1_epi8(0x20)), 'a', 26);
+	return _mm256_or_si256(letters, Digits256(chars));
+}
+
+/* Defines an AVX2 kernel that skips 32 chars at a time, then finishes with the SSE2 kernel */
+#define CHARSCAN_AVX2_KERNEL(name, classify, narrower) \
+	CHARSCAN_TARGET_AVX2 static size_t name(const char *chars, size_t index, size_t length) \
+	{ \
+		while (index + 32 <= length) \
+		{ \
+			__m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(chars + index)); \
+			unsigned mismatches = ~(unsigned) _mm256_movemask_epi8(classify(block)); \
+			if (mismatches != 0) return index + LowestBit(mismatches); \
+			index += 32; \
+		} \
+		return narrower(chars, index, length); \
+	}
+
+CHARSCAN_AVX2_KERNEL(SkipSpacesAVX2, Spaces256, SkipSpacesSSE2)
+CHARSCAN_AVX2_KERNEL(SkipAlnumAVX2, Alnum256, SkipAlnumSSE2)
+CHARSCAN_AVX2_KERNEL(SkipDigitsAVX2, Digits256, SkipDigitsSSE2)
+
+/**
+* @return whether the running CPU & OS support AVX2.
+*/
+static bool HasAVX2()
+{
+#ifdef _MSC_VER
+	int registers[4];
+
+	__cpuid(registers, 0);
+	if (registers[0] < 7) return false;
+
+	/* OS must save YMM registers on context switches (OSXSAVE & AVX, then XCR0 bits 1-2) */
+	__cpuid(registers, 1);
+	if ((registers[2] & (1 << 27)) == 0 || (registers[2] & (1 << 28)) == 0) return false;
+	if ((_xgetbv(0) & 6) != 6) return false;
+
+	__cpuidex(registers, 7, 0);
+	return (registers[1] & (1 << 5)) != 0;
+#else
+	return __builtin_cpu_supports("avx2");
+#endif
+}
+
+#endif
+
+/* Kernels selected for the running CPU */
+struct Kernels
+{
+	ScanKernel skipSpaces, skipAlnum, skipDigits;
+	const char *name;
+};
+
+static Kernels SelectKernels()
+{
+#ifdef CHARSCAN_X86
+	if (HasAVX2())
+	{
+		return Kernels{ SkipSpacesAVX2, SkipAlnumAVX2, SkipDigitsAVX2, "avx2" };
+	}
+
+	return Kernels{ SkipSpacesSSE2, SkipAlnumSSE2, SkipDigitsSSE2, "sse2" };
+#else
+	return Kernels{ SkipSpacesScalar, SkipAlnumScalar, SkipDigitsScalar, "scalar" };
+#endif
+}
+
+static const Kernels KERNELS = SelectKernels();
+
+size_t CharScan::SkipSpaces(std::string_view source, size_t index)
+{
+	return KERNELS.skipSpaces(source.data(), index, source.length());
+}
+
+size_t CharScan::SkipAlnum(std::string_view source, size_t index)
+{
+	return KERNELS.skipAlnum(source.data(), index, source.length());
+}
+
+size_t CharScan::SkipDigits(std::string_view source, size_t index)
+{
+	return KERNELS.skipDigits(source.data(), index, source.length());
+}
+
+const char *CharScan::KernelName()
+{
+	return KERNELS.name;
+}
@@ -0,0 +1,28 @@
+#pragma once
+#include <cstddef>
+#include <string_view>
+
+/**
+* Kernels that skip over a run of chars of the same kind, used by the Tokenizer for whitespace, identifiers & numbers.
+* On x86, runs are classified 32 (AVX2) or 16 (SSE2) chars at a time; the widest kernel supported by the running CPU
+* is selected once at startup, with a scalar fallback for other CPUs and for the tail of the source.
+*/
+namespace CharScan
+{
+	/**
+	* @return index of the first char at or after given index that isn't separating whitespace (' ', '\r', '\v', '\f').
+	*/
+	size_t SkipSpaces(std::string_view source, size_t index);
+	/**
+	* @return index of the first char at or after given index that isn't a letter or a digit.
+	*/
+	size_t SkipAlnum(std::string_view source, size_t index);
+	/**
+	* @return index of the first char at or after given index that isn't a digit.
+	*/
+	size_t SkipDigits(std::string_view source, size_t index);
+	/**
+	* @return name of the selected kernels ("avx2", "sse2" or "scalar").
+	*/
+	const char *KernelName();
+}
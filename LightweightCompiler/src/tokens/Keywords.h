@@ -0,0 +1,135 @@
+#pragma once
+#include "Token.h"
+#include <cstdint>
+#include <string_view>
+
+/**
+* Perfect hash of all reserved language keywords, built at compile time.
+* A candidate identifier is hashed from its length, first & last chars into a single table slot, so classifying it costs
+* one hash & at most one string compare, and never allocates.
+*/
+namespace Keywords
+{
+	struct Keyword
+	{
+		std::string_view text;
+		TokenType type;
+	};
+
+	/* TokenTypes for all reserved language keywords */
+	constexpr Keyword KEYWORDS[] =
+	{
+		{"if", TokenType::IF},
+		{"else", TokenType::ELSE},
+		{"elif", TokenType::ELIF},
+		{"for", TokenType::FOR},
+		{"while", TokenType::WHILE},
+		{"break", TokenType::BREAK},
+		{"continue", TokenType::CONTINUE},
+		{"print", TokenType::PRINT},
+		{"return", TokenType::RETURN},
+		{Token::FALSE_LITERAL, TokenType::BOOL},
+		{Token::TRUE_LITERAL, TokenType::BOOL},
+
+		{"void", TokenType::TYPE_VOID},
+		{"int", TokenType::TYPE_INT},
+		{"float", TokenType::TYPE_FLOAT},
+		{"bool", TokenType::TYPE_BOOL},
+		{"char", TokenType::TYPE_CHAR},
+	};
+
+	constexpr unsigned TABLE_BITS = 6;
+	constexpr size_t TABLE_SIZE = size_t(1) << TABLE_BITS;
+
+	/**
+	* Multiplicative hash of the identifier's length, first & last chars. Identifier must not be empty.
+	*/
+	constexpr uint32_t Hash(std::string_view text, uint32_t seed)
+	{
+		uint32_t key = uint32_t(text.length()) << 16 | uint32_t((unsigned char) text.front()) << 8 | uint32_t((unsigned char) text.back());
+		return uint32_t(key * seed) >> (32 - TABLE_BITS);
+	}
+
+	/**
+	* @return whether given seed hashes every keyword into a different slot.
+	*/
+	constexpr bool IsPerfect(uint32_t seed)
+	{
+		bool used[TABLE_SIZE] = {};
+
+		for (const Keyword &keyword : KEYWORDS)
+		{
+			uint32_t slot = Hash(keyword.text, seed);
+
+			if (used[slot]) return false;
+			used[slot] = true;
+		}
+
+		return true;
+	}
+
+	/**
+	* @return the first seed (from a sequence of odd golden-ratio multiples) that is perfect for the keywords, or 0 if none was found.
+	*/
+	constexpr uint32_t FindSeed()
+	{
+		for (uint32_t i = 1; i < 1024; i++)
+		{
+			uint32_t seed = uint32_t(0x9E3779B1u * i) | 1;
+
+			if (IsPerfect(seed)) return seed;
+		}
+
+		return 0;
+	}
+
+	constexpr uint32_t SEED = FindSeed();
+	static_assert(SEED != 0, "No perfect hash seed found for the keywords");
+
+	struct Table
+	{
+		Keyword slots[TABLE_SIZE];
+		size_t minLength, maxLength;
+	};
+
+	constexpr Table BuildTable()
+	{
+		Table table{};
+
+		table.minLength = SIZE_MAX;
+		table.maxLength = 0;
+
+		for (size_t slot = 0; slot < TABLE_SIZE; slot++)
+		{
+			/* Empty slots never match, since identifiers are never empty */
+			table.slots[slot] = Keyword{ std::string_view(), TokenType::ID };
+		}
+
+		for (const Keyword &keyword : KEYWORDS)
+		{
+			table.slots[Hash(keyword.text, SEED)] = keyword;
+
+			if (keyword.text.length() < table.minLength) table.minLength = keyword.text.length();
+			if (keyword.text.length() > table.maxLength) table.maxLength = keyword.text.length();
+		}
+
+		return table;
+	}
+
+	inline constexpr Table TABLE = BuildTable();
+
+	/**
+	* @param text a scanned identifier.
+	* @return the keyword's TokenType if given identifier is a reserved keyword, and ID otherwise.
+	*/
+	inline TokenType Lookup(std::string_view text)
+	{
+		if (text.length() < TABLE.minLength || text.length() > TABLE.maxLength)
+		{
+			return TokenType::ID;
+		}
+
+		const Keyword &candidate = TABLE.slots[Hash(text, SEED)];
+		return candidate.text == text ? candidate.type : TokenType::ID;
+	}
+}
@@ -0,0 +1,198 @@
+#pragma once
+#include "Token.h"
+#include <cstdint>
+
+/**
+* Tables of the Tokenizer's DFA, generated at compile time from the operator spellings below.
+* Every source char is mapped to a char class, and every (state, char class) pair is mapped to the next state.
+* Scanning a Token is a single forward walk over the transition table, without any backtracking: the walk stops once
+* there's no transition, and the Token's type is the accepted type of the state it stopped at.
+*/
+namespace LexTables
+{
+	/* Spelling of an operator Token & its TokenType */
+	struct Spelling
+	{
+		const char *text;
+		TokenType type;
+	};
+
+	/* All operators, brackets & punctuation. Longer operators are recognized by walking through their prefixes */
+	constexpr Spelling OPERATORS[] =
+	{
+		{"(", TokenType::LP}, {")", TokenType::RP},
+		{"[", TokenType::LS}, {"]", TokenType::RS},
+		{"{", TokenType::LC}, {"}", TokenType::RC},
+
+		{"+", TokenType::ADD}, {"+=", TokenType::EQ_ADD},
+		{"-", TokenType::SUB}, {"-=", TokenType::EQ_SUB},
+		{"*", TokenType::MULT}, {"*=", TokenType::EQ_MULT}, {"**", TokenType::POW},
+		{"/", TokenType::DIV}, {"/=", TokenType::EQ_DIV},
+		{"%", TokenType::MOD}, {"%=", TokenType::EQ_MOD},
+		{"~", TokenType::BNOT}, {"~=", TokenType::EQ_BNOT},
+		{"^", TokenType::BXOR}, {"^=", TokenType::EQ_XOR},
+		{"&", TokenType::BAND}, {"&=", TokenType::EQ_BAND}, {"&&", TokenType::AND},
+		{"|", TokenType::BOR}, {"|=", TokenType::EQ_BOR}, {"||", TokenType::OR},
+		{"=", TokenType::EQ}, {"==", TokenType::EQEQ},
+		{"!", TokenType::NOT}, {"!=", TokenType::NEQ},
+		{"<", TokenType::LESS}, {"<=", TokenType::LEQ}, {"<<", TokenType::SHL}, {"<<=", TokenType::EQ_SHL},
+		{">", TokenType::GRTR}, {">=", TokenType::GEQ}, {">>", TokenType::SHR}, {">>=", TokenType::EQ_SHR},
+		{"?", TokenType::QMARK}, {":", TokenType::COLON}, {",", TokenType::COMMA},
+
+		{"\n", TokenType::ENDL}, {"\t", TokenType::INDENT},
+	};
+
+	/* Fixed char classes. Every char that appears in an operator gets a class of its own after these */
+	enum CharClass : uint8_t
+	{
+		OTHER, // Any char that can't start or continue a Token
+		SPACE, // Whitespace that separates Tokens (indentation & line breaks are Tokens themselves)
+		DIGIT,
+		ALPHA,
+		DOT,
+		APOST,
+		FIXED_CLASS_COUNT
+	};
+
+	/* Fixed states. Operator states are added after these */
+	enum State : uint8_t
+	{
+		START,
+		ID,
+		INT,
+		FLOAT,
+		CHAR_OPEN, // Opening apostrophe
+		CHAR_BODY, // Opening apostrophe & the char
+		CHAR_CLOSE, // Complete char literal
+		FIXED_STATE_COUNT
+	};
+
+	/* Kind of char run a state loops on. Such runs are skipped in bulk instead of one transition per char */
+	enum Run : uint8_t
+	{
+		NO_RUN,
+		ALNUM_RUN,
+		DIGIT_RUN,
+	};
+
+	constexpr size_t MAX_CLASSES = 32;
+	constexpr size_t MAX_STATES = 64;
+	/* Marks a missing transition, meaning the current Token ends */
+	constexpr uint8_t DEAD = 0xFF;
+
+	struct Tables
+	{
+		/* Char class of every char */
+		uint8_t charClass[256];
+		/* Next state for every (state, char class) pair */
+		uint8_t next[MAX_STATES][MAX_CLASSES];
+		/* TokenType accepted by every state. INVALID for states that don't complete a Token */
+		TokenType accept[MAX_STATES];
+		/* Run every state loops on */
+		uint8_t run[MAX_STATES];
+		uint8_t classCount;
+		uint8_t stateCount;
+	};
+
+	constexpr Tables Build()
+	{
+		Tables tables{};
+
+		for (size_t c = 0; c < 256; c++)
+		{
+			bool isDigit = c >= '0' && c <= '9';
+			bool isAlpha = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
+			bool isSpace = c == ' ' || c == '\r' || c == '\v' || c == '\f';
+
+			tables.charClass[c] = isDigit ? DIGIT : isAlpha ? ALPHA : isSpace ? SPACE : c == '.' ? DOT : c == '\'' ? APOST : OTHER;
+		}
+
+		tables.classCount = FIXED_CLASS_COUNT;
+
+		/* Give every operator char a class of its own */
+		for (const Spelling &spelling : OPERATORS)
+		{
+			for (const char *iter = spelling.text; *iter; iter++)
+			{
+				uint8_t &charClass = tables.charClass[(unsigned char) *iter];
+
+				if (charClass == OTHER)
+				{
+					charClass = tables.classCount++;
+				}
+			}
+		}
+
+		for (size_t state = 0; state < MAX_STATES; state++)
+		{
+			for (size_t charClass = 0; charClass < MAX_CLASSES; charClass++)
+			{
+				tables.next[state][charClass] = DEAD;
+			}
+
+			tables.accept[state] = TokenType::INVALID;
+			tables.run[state] = NO_RUN;
+		}
+
+		/* Identifiers: a letter followed by letters & digits */
+		tables.next[START][ALPHA] = ID;
+		tables.next[ID][ALPHA] = ID;
+		tables.next[ID][DIGIT] = ID;
+		tables.accept[ID] = TokenType::ID;
+		tables.run[ID] = ALNUM_RUN;
+
+		/* Numbers: digits, optionally followed by a single decimal point & more digits */
+		tables.next[START][DIGIT] = INT;
+		tables.next[INT][DIGIT] = INT;
+		tables.next[INT][DOT] = FLOAT;
+		tables.next[FLOAT][DIGIT] = FLOAT;
+		tables.accept[INT] = TokenType::INT;
+		tables.accept[FLOAT] = TokenType::FLOAT;
+		tables.run[INT] = DIGIT_RUN;
+		tables.run[FLOAT] = DIGIT_RUN;
+
+		/* Chars: any single char between apostrophes */
+		tables.next[START][APOST] = CHAR_OPEN;
+		for (size_t charClass = 0; charClass < MAX_CLASSES; charClass++)
+		{
+			tables.next[CHAR_OPEN][charClass] = CHAR_BODY;
+		}
+		tables.next[CHAR_BODY][APOST] = CHAR_CLOSE;
+		tables.accept[CHAR_CLOSE] = TokenType::CHAR;
+
+		tables.stateCount = FIXED_STATE_COUNT;
+
+		/* Insert every operator into the DFA as a trie, each prefix being a state */
+		for (const Spelling &spelling : OPERATORS)
+		{
+			uint8_t state = START;
+
+			for (const char *iter = spelling.text; *iter; iter++)
+			{
+				uint8_t charClass = tables.charClass[(unsigned char) *iter];
+
+				if (tables.next[state][charClass] == DEAD)
+				{
+					tables.next[state][charClass] = tables.stateCount++;
+				}
+
+				state = tables.next[state][charClass];
+			}
+
+			tables.accept[state] = spelling.type;
+		}
+
+		/* Indentation: a whole run of tabs is a single INDENT Token, whose tabs are the indentation depth. Spaces in between are skipped like anywhere else */
+		uint8_t tabClass = tables.charClass[(unsigned char) '\t'];
+		uint8_t indent = tables.next[START][tabClass];
+		tables.next[indent][tabClass] = indent;
+		tables.next[indent][SPACE] = indent;
+
+		return tables;
+	}
+
+	inline constexpr Tables TABLES = Build();
+
+	static_assert(TABLES.classCount <= MAX_CLASSES, "Too many char classes for the lexer tables");
+	static_assert(TABLES.stateCount <= MAX_STATES, "Too many states for the lexer tables");
+}
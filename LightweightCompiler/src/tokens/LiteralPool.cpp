@@ -0,0 +1,30 @@
+#include "LiteralPool.h"
+#include <cstring>
+
+const size_t LiteralPool::PAGE_SIZE = 64 * 1024;
+
+LiteralPool::LiteralPool() :
+	cursor(NULL),
+	remaining(0)
+{
+}
+
+std::string_view LiteralPool::Store(std::string_view text)
+{
+	if (text.length() > remaining)
+	{
+		size_t pageSize = text.length() > PAGE_SIZE ? text.length() : PAGE_SIZE;
+
+		pages.push_back(std::unique_ptr<char[]>(new char[pageSize]));
+		cursor = pages.back().get();
+		remaining = pageSize;
+	}
+
+	std::memcpy(cursor, text.data(), text.length());
+	std::string_view stored(cursor, text.length());
+
+	cursor += text.length();
+	remaining -= text.length();
+
+	return stored;
+}
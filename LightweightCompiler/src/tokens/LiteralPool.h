@@ -0,0 +1,30 @@
+#pragma once
+#include <memory>
+#include <string_view>
+#include <vector>
+
+/**
+* Owns copies of source text whose buffer doesn't live long enough (e.g. a streamed chunk that gets reused).
+* Returned views stay valid for as long as the pool lives.
+*/
+class LiteralPool
+{
+private:
+	/* Size of every storage page. Longer literals get a dedicated page */
+	static const size_t PAGE_SIZE;
+
+	/* Storage pages. Pages are never reallocated, so views into them stay valid */
+	std::vector<std::unique_ptr<char[]>> pages;
+	/* Free space left in the current page */
+	char *cursor;
+	size_t remaining;
+
+public:
+	LiteralPool();
+
+	/**
+	* @param text text that may be invalidated later.
+	* @return an equal text that lives as long as the pool.
+	*/
+	std::string_view Store(std::string_view text);
+};
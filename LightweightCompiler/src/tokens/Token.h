@@ -1,6 +1,7 @@
 #pragma once
 #include <iostream>
 #include <string>
+#include <string_view>
 
 /* Enums representing all possible Token types */
 enum class TokenType
@@ -39,7 +40,8 @@ enum class TokenType
 	APOST,
 
 	/* Misc */
-	INDENT, ENDL, INVALID
+	INDENT, // A run of tabs, & any spaces between them; the literal's tabs are the indentation depth
+	ENDL, INVALID
 };
 
 /* Struct representing a Token */
@@ -47,13 +49,13 @@ struct Token
 {
 	/* Constant Strings for true/false boolean values.
 	   We save these values because they will be used elsewhere as well. */
-	static const std::string FALSE_LITERAL;
-	static const std::string TRUE_LITERAL;
+	static constexpr std::string_view FALSE_LITERAL = "false";
+	static constexpr std::string_view TRUE_LITERAL = "true";
 
 	/* The type of this Token */
 	TokenType type;
-	/* Pointer to the literal of this Token. Can be null if Token has no literal */
-	std::string literal;
+	/* View of this Token's literal inside the source buffer. The source must outlive the Token */
+	std::string_view literal;
 };
 
 /**
@@ -0,0 +1,66 @@
+#pragma once
+#include "Token.h"
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+/**
+* Batch of Tokens stored as a structure of arrays.
+* Types are kept in a dense byte array apart from the literals, so lookahead that only compares types (which is most of the
+* Parser's work) walks one compact array instead of striding over whole Tokens.
+* Literals are stored as offset & length into the batch's base text, which must outlive the batch.
+*/
+struct TokenArrays
+{
+	/* Text every literal views into */
+	std::string_view base;
+	/* Every Token's TokenType */
+	std::vector<uint8_t> types;
+	/* Every Token's literal, as its first char's offset into base & its length */
+	std::vector<uint32_t> offsets;
+	std::vector<uint32_t> lengths;
+
+	void Add(TokenType type, size_t offset, size_t length)
+	{
+		types.push_back(static_cast<uint8_t>(type));
+		offsets.push_back(static_cast<uint32_t>(offset));
+		lengths.push_back(static_cast<uint32_t>(length));
+	}
+
+	void Reserve(size_t count)
+	{
+		types.reserve(count);
+		offsets.reserve(count);
+		lengths.reserve(count);
+	}
+
+	size_t Size() const
+	{
+		return types.size();
+	}
+
+	bool Empty() const
+	{
+		return types.empty();
+	}
+
+	TokenType Type(size_t index) const
+	{
+		return static_cast<TokenType>(types[index]);
+	}
+
+	std::string_view Literal(size_t index) const
+	{
+		return base.substr(offsets[index], lengths[index]);
+	}
+
+	/**
+	* @return the Token at given index, with its literal viewing into base.
+	*/
+	Token Get(size_t index) const
+	{
+		return Token{ Type(index), Literal(index) };
+	}
+};
+
+static_assert(static_cast<int>(TokenType::INVALID) <= UINT8_MAX, "TokenTypes must fit in TokenArrays' type bytes");
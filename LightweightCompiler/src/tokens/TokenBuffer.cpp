@@ -0,0 +1,147 @@
+#include "TokenBuffer.h"
+#include "TokenStream.h"
+#include <algorithm>
+
+TokenBuffer::TokenBuffer(TokenArrays &&tokens) :
+	stream(NULL),
+	lastSegment(0),
+	cachedTypes(NULL),
+	cachedStart(0),
+	cachedCount(0)
+{
+	AddSegment(std::move(tokens));
+}
+
+TokenBuffer::TokenBuffer(TokenStream &stream) :
+	stream(&stream),
+	lastSegment(0),
+	cachedTypes(NULL),
+	cachedStart(0),
+	cachedCount(0)
+{
+}
+
+TokenBuffer::TokenBuffer(const TokenBuffer &source, size_t end) :
+	stream(NULL),
+	lastSegment(0),
+	cachedTypes(NULL),
+	cachedStart(0),
+	cachedCount(0)
+{
+	/* Keep the segments up to the one that holds the view's last Token, and cut that one at the view's end */
+	size_t count = std::lower_bound(source.segmentEnds.begin(), source.segmentEnds.end(), end) - source.segmentEnds.begin();
+	if (count < source.segmentEnds.size()) count++;
+
+	segments.assign(source.segments.begin(), source.segments.begin() + count);
+	segmentEnds.assign(source.segmentEnds.begin(), source.segmentEnds.begin() + count);
+
+	if (count > 0) segmentEnds.back() = end;
+}
+
+void TokenBuffer::AddSegment(TokenArrays &&batch)
+{
+	if (batch.Empty())
+	{
+		return;
+	}
+
+	size_t end = Size() + batch.Size();
+
+	batches.push_back(std::move(batch));
+	segments.push_back(&batches.back());
+	segmentEnds.push_back(end);
+}
+
+bool TokenBuffer::Pull()
+{
+	if (stream == NULL)
+	{
+		return false;
+	}
+
+	TokenArrays batch;
+
+	if (!stream->NextBatch(batch))
+	{
+		stream = NULL;
+		return false;
+	}
+
+	AddSegment(std::move(batch));
+	return true;
+}
+
+bool TokenBuffer::HasSlow(size_t index)
+{
+	while (index >= Size())
+	{
+		if (!Pull())
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+const TokenArrays &TokenBuffer::Locate(size_t index, size_t &offset)
+{
+	size_t segmentStart = lastSegment == 0 ? 0 : segmentEnds[lastSegment - 1];
+
+	if (index < segmentStart || index >= segmentEnds[lastSegment])
+	{
+		/* Find the first segment that ends after given index */
+		lastSegment = std::upper_bound(segmentEnds.begin(), segmentEnds.end(), index) - segmentEnds.begin();
+		segmentStart = lastSegment == 0 ? 0 : segmentEnds[lastSegment - 1];
+	}
+
+	const TokenArrays &segment = *segments[lastSegment];
+
+	cachedTypes = segment.types.data();
+	cachedStart = segmentStart;
+	/* A view may end inside its last segment */
+	cachedCount = segmentEnds[lastSegment] - segmentStart;
+
+	offset = index - segmentStart;
+	return segment;
+}
+
+TokenType TokenBuffer::TypeAtSlow(size_t index)
+{
+	/* Past the end; the Parser sometimes peeks there before checking for EOF */
+	if (!Has(index))
+	{
+		return TokenType::INVALID;
+	}
+
+	size_t offset;
+	return Locate(index, offset).Type(offset);
+}
+
+Token TokenBuffer::At(size_t index)
+{
+	if (!Has(index))
+	{
+		return Token{ TokenType::INVALID, "" };
+	}
+
+	size_t offset;
+	return Locate(index, offset).Get(offset);
+}
+
+size_t TokenBuffer::Size() const
+{
+	return segmentEnds.empty() ? 0 : segmentEnds.back();
+}
+
+bool TokenBuffer::Streaming() const
+{
+	return stream != NULL;
+}
+
+void TokenBuffer::Fill()
+{
+	while (Pull())
+	{
+	}
+}
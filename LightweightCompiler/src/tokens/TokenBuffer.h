@@ -0,0 +1,118 @@
+#pragma once
+#include "Token.h"
+#include "TokenArrays.h"
+#include <deque>
+#include <vector>
+
+class TokenStream;
+
+/**
+* Random-access sequence of Tokens consumed by the Parser.
+* Tokens are stored in segments of TokenArrays that are never modified once added, so the text their literals view stays valid while more Tokens arrive.
+* A TokenBuffer can either hold already-scanned Tokens, or pull batches from a TokenStream on demand.
+* A view of a TokenBuffer's first Tokens can be created for another thread: views share the segments, but each has its own lookup cache.
+*/
+class TokenBuffer
+{
+private:
+	/* Every batch of Tokens received by this buffer. Elements of a deque never move, so segments can point to them */
+	std::deque<TokenArrays> batches;
+	/* Every segment of Tokens, in order. Views point to their source's batches */
+	std::vector<const TokenArrays *> segments;
+	/* Index one past the last Token of each segment (or of the view) */
+	std::vector<size_t> segmentEnds;
+	/* Stream that feeds this buffer. Null once the stream is exhausted, or if there was never one */
+	TokenStream *stream;
+	/* Segment of the last accessed Token. The Parser mostly moves sequentially, so this usually hits */
+	size_t lastSegment;
+	/* Type bytes, first index & Token count of the last accessed segment, so type lookups there skip the segment search */
+	const uint8_t *cachedTypes;
+	size_t cachedStart, cachedCount;
+
+	/**
+	* Pulls the next batch from the stream.
+	*
+	* @return false if the stream is exhausted.
+	*/
+	bool Pull();
+	/**
+	* Appends given batch as a new segment.
+	*/
+	void AddSegment(TokenArrays &&batch);
+	/**
+	* Finds the segment that holds given index. Index must be valid.
+	*
+	* @param offset receives given index's offset inside the segment.
+	* @return the segment that holds given index.
+	*/
+	const TokenArrays &Locate(size_t index, size_t &offset);
+	/**
+	* Has for indices outside the last accessed segment.
+	*/
+	bool HasSlow(size_t index);
+	/**
+	* TypeAt for indices outside the last accessed segment.
+	*/
+	TokenType TypeAtSlow(size_t index);
+
+public:
+	/**
+	* Construct TokenBuffer that holds given Tokens.
+	*/
+	TokenBuffer(TokenArrays &&tokens);
+	/**
+	* Construct TokenBuffer that pulls its Tokens from given stream as the Parser needs them.
+	*/
+	TokenBuffer(TokenStream &stream);
+	/**
+	* Construct a read-only view of given buffer's Tokens before given end, which must already be received.
+	* The view ends at end as if the source ended there, and can be read by another thread while other views of the source are read.
+	*/
+	TokenBuffer(const TokenBuffer &source, size_t end);
+
+	TokenBuffer(const TokenBuffer &) = delete;
+	TokenBuffer &operator=(const TokenBuffer &) = delete;
+
+	/**
+	* Checks whether there's a Token at given index, waiting for the stream if required.
+	*
+	* @return whether given index is valid.
+	*/
+	bool Has(size_t index)
+	{
+		return index - cachedStart < cachedCount || HasSlow(index);
+	}
+	/**
+	* Retrieves the TokenType at given index, waiting for the stream if required.
+	*
+	* @return the TokenType at given index, or INVALID if the index is past the end.
+	*/
+	TokenType TypeAt(size_t index)
+	{
+		/* Unsigned wrap-around makes indices before the cached segment fail the check as well */
+		if (index - cachedStart < cachedCount)
+		{
+			return static_cast<TokenType>(cachedTypes[index - cachedStart]);
+		}
+
+		return TypeAtSlow(index);
+	}
+	/**
+	* Retrieves the Token at given index, waiting for the stream if required.
+	*
+	* @return the Token at given index, or an INVALID Token if the index is past the end.
+	*/
+	Token At(size_t index);
+	/**
+	* @return the amount of Tokens received so far.
+	*/
+	size_t Size() const;
+	/**
+	* @return whether more Tokens may still arrive from the stream, so Size isn't the total amount of Tokens yet.
+	*/
+	bool Streaming() const;
+	/**
+	* Waits until the stream is exhausted, so Size is the total amount of Tokens.
+	*/
+	void Fill();
+};
@@ -0,0 +1,71 @@
+#pragma once
+#include "Token.h"
+#include <cstdint>
+#include <initializer_list>
+
+/**
+* Set of TokenTypes stored as a bitmask, one bit per TokenType.
+* Sets are meant to be built at compile time, so checking whether a TokenType is in a set costs a shift & an AND.
+*/
+class TokenSet
+{
+private:
+	static constexpr unsigned WORD_BITS = 64;
+	static constexpr unsigned WORD_COUNT = 2;
+
+	uint64_t words[WORD_COUNT];
+
+public:
+	constexpr TokenSet() :
+		words{ 0, 0 }
+	{
+	}
+
+	/**
+	* Construct a set with a single TokenType, so a TokenType can be passed wherever a TokenSet is expected.
+	*/
+	constexpr TokenSet(TokenType type) :
+		words{ 0, 0 }
+	{
+		unsigned bit = static_cast<unsigned>(type);
+		words[bit / WORD_BITS] |= uint64_t(1) << (bit % WORD_BITS);
+	}
+
+	constexpr TokenSet(std::initializer_list<TokenType> types) :
+		words{ 0, 0 }
+	{
+		for (TokenType type : types)
+		{
+			unsigned bit = static_cast<unsigned>(type);
+			words[bit / WORD_BITS] |= uint64_t(1) << (bit % WORD_BITS);
+		}
+	}
+
+	/**
+	* @return whether given TokenType is in this set.
+	*/
+	constexpr bool Contains(TokenType type) const
+	{
+		unsigned bit = static_cast<unsigned>(type);
+		return (words[bit / WORD_BITS] >> (bit % WORD_BITS)) & 1;
+	}
+
+	/**
+	* @return the union of this set & given set.
+	*/
+	constexpr TokenSet operator|(const TokenSet &other) const
+	{
+		TokenSet result;
+
+		for (unsigned i = 0; i < WORD_COUNT; i++)
+		{
+			result.words[i] = words[i] | other.words[i];
+		}
+
+		return result;
+	}
+
+	static constexpr unsigned CAPACITY = WORD_BITS * WORD_COUNT;
+};
+
+static_assert(static_cast<unsigned>(TokenType::INVALID) < TokenSet::CAPACITY, "Too many TokenTypes for TokenSet");
@@ -0,0 +1,102 @@
+#include "TokenStream.h"
+#include "Tokenizer.h"
+#include <cstdlib>
+
+const size_t TokenStream::CHUNK_SIZE = 64 * 1024;
+const size_t TokenStream::QUEUE_CAPACITY = 16;
+
+TokenStream::TokenStream(const std::string &filePath) :
+	file(std::fopen(filePath.c_str(), "r")),
+	batches(QUEUE_CAPACITY),
+	waitTime(0),
+	scanMicros(0)
+{
+	if (file == NULL)
+	{
+		std::cout << "Could not open " << filePath << ".";
+		exit(1);
+	}
+
+	producer = std::thread(&TokenStream::Produce, this);
+}
+
+TokenStream::~TokenStream()
+{
+	/* Unblock the producer incase the consumer stopped early */
+	batches.Close();
+	producer.join();
+	std::fclose(file);
+}
+
+bool TokenStream::ScanLines(std::string_view lines)
+{
+	/* The chunk buffer is about to be reused, so the Tokens must view storage that outlives it */
+	Tokenizer tokenizer(literals.Store(lines));
+	TokenArrays batch = tokenizer.ScanTokens();
+
+	/* Waiting for a full queue to drain isn't part of the lexer's time */
+	auto waitStart = std::chrono::steady_clock::now();
+	bool pushed = batches.Push(std::move(batch));
+	waitTime += std::chrono::steady_clock::now() - waitStart;
+
+	return pushed;
+}
+
+void TokenStream::Produce()
+{
+	auto start = std::chrono::steady_clock::now();
+
+	/* Holds the current chunk, starting with whatever incomplete line was left from the previous chunk */
+	std::string chunk;
+
+	while (true)
+	{
+		size_t carried = chunk.length();
+
+		chunk.resize(carried + CHUNK_SIZE);
+		size_t read = std::fread(&chunk[carried], 1, CHUNK_SIZE, file);
+		chunk.resize(carried + read);
+
+		if (read == 0)
+		{
+			break;
+		}
+
+		size_t lastLine = chunk.rfind('\n');
+
+		/* No complete line yet, keep reading until the line ends */
+		if (lastLine == std::string::npos)
+		{
+			continue;
+		}
+
+		/* Consumer is gone, no point in reading the rest of the file */
+		if (!ScanLines(std::string_view(chunk).substr(0, lastLine + 1)))
+		{
+			return;
+		}
+
+		/* Carry the incomplete last line over to the next chunk */
+		chunk.erase(0, lastLine + 1);
+	}
+
+	/* Last line might not end with a line break; the Tokenizer terminates it */
+	if (!chunk.empty())
+	{
+		ScanLines(chunk);
+	}
+
+	/* Set before closing the queue, so it's known once the consumer sees the end */
+	scanMicros = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start - waitTime).count();
+	batches.Close();
+}
+
+bool TokenStream::NextBatch(TokenArrays &batch)
+{
+	return batches.Pop(batch);
+}
+
+uint64_t TokenStream::ScanMicros() const
+{
+	return scanMicros;
+}
@@ -0,0 +1,75 @@
+#pragma once
+#include "TokenArrays.h"
+#include "LiteralPool.h"
+#include "../util/BoundedQueue.h"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+* Tokenizes a source file on a background thread, without ever holding the whole file in memory.
+* The file is read in fixed-size chunks; every chunk is cut at its last line break (Tokens never span lines),
+* tokenized, and handed to the consumer as a batch of Tokens through a bounded queue.
+* Chunk buffers are reused, so every chunk's lines are copied into the stream's LiteralPool, which the batch's literals view.
+*/
+class TokenStream
+{
+private:
+	/* Amount of bytes read from the file at a time */
+	static const size_t CHUNK_SIZE;
+	/* Maximum amount of scanned batches waiting for the consumer */
+	static const size_t QUEUE_CAPACITY;
+
+	/* Source file being read */
+	std::FILE *file;
+	/* Owns the text viewed by all produced Tokens */
+	LiteralPool literals;
+	/* Batches of Tokens waiting for the consumer */
+	BoundedQueue<TokenArrays> batches;
+	/* Reads & tokenizes the file */
+	std::thread producer;
+	/* Time the producer spent waiting for the consumer to take a batch. Only used by the producer */
+	std::chrono::steady_clock::duration waitTime;
+	/* Time the producer spent reading & tokenizing, in microseconds. Set once the whole file was queued */
+	std::atomic<uint64_t> scanMicros;
+
+	/**
+	* Producer thread's entry point. Reads, tokenizes & queues the entire file, then closes the queue.
+	*/
+	void Produce();
+	/**
+	* Tokenizes given complete lines & queues the resulting batch.
+	*
+	* @return false if the queue was closed by the consumer.
+	*/
+	bool ScanLines(std::string_view lines);
+
+public:
+	/**
+	* Opens given file & starts tokenizing it in the background.
+	*/
+	TokenStream(const std::string &filePath);
+	~TokenStream();
+
+	TokenStream(const TokenStream &) = delete;
+	TokenStream &operator=(const TokenStream &) = delete;
+
+	/**
+	* Waits for the next batch of Tokens.
+	*
+	* @param batch receives the next batch.
+	* @return false if the whole file was already consumed.
+	*/
+	bool NextBatch(TokenArrays &batch);
+
+	/**
+	* The lexer runs alongside the consumer, so its time can't be measured from outside without waiting for the whole file.
+	*
+	* @return the time the producer spent reading & tokenizing the file, not counting the time it waited for the consumer, in microseconds.
+	* 0 until every batch was consumed.
+	*/
+	uint64_t ScanMicros() const;
+};
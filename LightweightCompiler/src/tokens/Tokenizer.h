@@ -1,30 +1,20 @@
 #pragma once
 #include "Token.h"
-#include <vector>
-#include <unordered_map>
+#include "TokenArrays.h"
 
 class Tokenizer
 {
 private:
-	/* TokenTypes for all reserved language keywords mapped by their strings */
-	static const std::unordered_map<std::string, TokenType> KEYWORDS;
-
-	/* Source code to tokenize */
-	const std::string &source;
+	/* Source code to tokenize. Every scanned Token views into it, so it must outlive the Tokens */
+	std::string_view source;
 	/* Current char's index */
 	size_t index;
 	/* Index of the first char of the current Token */
 	size_t tokenStart;
 
-	/**
-	* @param type the Token's type.
-	* @return Token with current char streak (from tokenStart to index) and given type.
-	*/
-	Token CreateToken(TokenType type);
 	void StartToken();
-	void Expect(int charCount, ...);
 	/**
-	* @return current char from source.
+	* @return current char from source. Doesn't verify that there's a current char.
 	*/
 	char Current();
 	/**
@@ -32,57 +22,29 @@ private:
 	*/
 	void Next();
 	/**
-	* Return to previous char by decreasing index.
-	*/
-	void Prev();
-	/**
 	* @return whether current char is out of range or not.
 	*/
 	bool HasCurrent();
 	/**
-	* @param ch is the desired char.
-	* @return whether next char is given char.
-	*
-	* Checks whether next char is given char.
-	* If there's a match, it advances to the next char.
-	*/
-	bool MatchNext(char ch);
-	bool IsIndent();
-	/**
 	* Skips next whitespace chars.
 	*/
 	void SkipWhitespace();
 	/**
-	* @return numeric Token.
-	*
-	* This function should be called only when encountering a digit.
-	*/
-	Token ScanLiteral();
-	Token ScanKeyword();
-	Token ScanChar();
-	/**
-	* @return basic Token.
-	*/
-	Token ScanOperator();
-	/* Scan indentation ('\t'), as this language is space-sensitive */
-	Token ScanIndent();
-	/**
-	* @return current Token.
+	* Scans the Token starting at current index by walking the lexer's DFA, and appends it to given Tokens.
+	* When the function exits, the current char is the first char after the scanned Token.
 	*
-	* Scans & returns Token starting at current index.
-	* When the function exits, the cur char is the last char in the scanned Token.
+	* @param tokens receives the scanned Token.
 	*/
-	Token ScanToken();
+	void ScanToken(TokenArrays &tokens);
 
 public:
 	/**
 	* Construct Lexer with given source.
 	*/
-	Tokenizer(const std::string &source);
+	Tokenizer(std::string_view source);
 
 	/**
-	* @param src is the source to be tokenized.
-	* @return list of Tokens in the source.
+	* @return all Tokens in the source, viewing into it.
 	*/
-	std::vector<Token> ScanTokens();
+	TokenArrays ScanTokens();
 };
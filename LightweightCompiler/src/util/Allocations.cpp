@@ -0,0 +1,180 @@
+#include "Allocations.h"
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+#ifdef _WIN32
+#include <malloc.h>
+#endif
+
+/* Constant-initialized, so allocations made while other globals are constructed are counted too */
+static std::atomic<uint64_t> allocationCount{ 0 };
+static std::atomic<uint64_t> allocatedBytes{ 0 };
+
+void CountAllocation(size_t bytes)
+{
+	allocationCount.fetch_add(1, std::memory_order_relaxed);
+	allocatedBytes.fetch_add(bytes, std::memory_order_relaxed);
+}
+
+Allocations AllocationsSoFar()
+{
+	return Allocations{ allocationCount.load(std::memory_order_relaxed), allocatedBytes.load(std::memory_order_relaxed) };
+}
+
+/*
+* Replacements of the global operator new & delete. Every form is replaced, aligned ones included, so memory is always allocated & freed
+* by the same pair, even where the runtime (e.g. a sanitizer) provides its own versions of the forms that aren't replaced.
+*/
+
+void *operator new(size_t size)
+{
+	CountAllocation(size);
+
+	/* malloc may return NULL for 0 bytes, but new must return a unique pointer */
+	void *block = std::malloc(size == 0 ? 1 : size);
+
+	if (block == NULL)
+	{
+		throw std::bad_alloc();
+	}
+
+	return block;
+}
+
+void *operator new[](size_t size)
+{
+	return operator new(size);
+}
+
+void *operator new(size_t size, const std::nothrow_t &) noexcept
+{
+	CountAllocation(size);
+	return std::malloc(size == 0 ? 1 : size);
+}
+
+void *operator new[](size_t size, const std::nothrow_t &tag) noexcept
+{
+	return operator new(size, tag);
+}
+
+void operator delete(void *block) noexcept
+{
+	std::free(block);
+}
+
+void operator delete[](void *block) noexcept
+{
+	std::free(block);
+}
+
+void operator delete(void *block, size_t) noexcept
+{
+	std::free(block);
+}
+
+void operator delete[](void *block, size_t) noexcept
+{
+	std::free(block);
+}
+
+void operator delete(void *block, const std::nothrow_t &) noexcept
+{
+	std::free(block);
+}
+
+void operator delete[](void *block, const std::nothrow_t &) noexcept
+{
+	std::free(block);
+}
+
+/**
+* Allocates & counts a block of given size at given alignment, which is a power of two of at least the alignment new guarantees.
+*
+* @return the block, or NULL if it can't be allocated. Freed by FreeAligned.
+*/
+static void *AllocateAligned(size_t size, std::align_val_t alignment)
+{
+	CountAllocation(size);
+
+	if (size == 0)
+	{
+		size = 1;
+	}
+
+#ifdef _WIN32
+	return _aligned_malloc(size, (size_t) alignment);
+#else
+	void *block;
+	return posix_memalign(&block, (size_t) alignment, size) == 0 ? block : NULL;
+#endif
+}
+
+/**
+* Frees a block allocated by AllocateAligned. Windows can't free aligned blocks with free.
+*/
+static void FreeAligned(void *block)
+{
+#ifdef _WIN32
+	_aligned_free(block);
+#else
+	std::free(block);
+#endif
+}
+
+void *operator new(size_t size, std::align_val_t alignment)
+{
+	void *block = AllocateAligned(size, alignment);
+
+	if (block == NULL)
+	{
+		throw std::bad_alloc();
+	}
+
+	return block;
+}
+
+void *operator new[](size_t size, std::align_val_t alignment)
+{
+	return operator new(size, alignment);
+}
+
+void *operator new(size_t size, std::align_val_t alignment, const std::nothrow_t &) noexcept
+{
+	return AllocateAligned(size, alignment);
+}
+
+void *operator new[](size_t size, std::align_val_t alignment, const std::nothrow_t &) noexcept
+{
+	return AllocateAligned(size, alignment);
+}
+
+void operator delete(void *block, std::align_val_t) noexcept
+{
+	FreeAligned(block);
+}
+
+void operator delete[](void *block, std::align_val_t) noexcept
+{
+	FreeAligned(block);
+}
+
+void operator delete(void *block, size_t, std::align_val_t) noexcept
+{
+	FreeAligned(block);
+}
+
+void operator delete[](void *block, size_t, std::align_val_t) noexcept
+{
+	FreeAligned(block);
+}
+
+void operator delete(void *block, std::align_val_t, const std::nothrow_t &) noexcept
+{
+	FreeAligned(block);
+}
+
+void operator delete[](void *block, std::align_val_t, const std::nothrow_t &) noexcept
+{
+	FreeAligned(block);
+}
@@ -0,0 +1,19 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+/* Heap allocations made by the whole process so far. Every operator new counts, and so does every block an Arena allocates */
+struct Allocations
+{
+	uint64_t count, bytes;
+};
+
+/**
+* Counts an allocation of given size that didn't go through operator new.
+*/
+void CountAllocation(size_t bytes);
+
+/**
+* @return the allocations made by all threads so far.
+*/
+Allocations AllocationsSoFar();
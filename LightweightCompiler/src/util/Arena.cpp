@@ -0,0 +1,102 @@
+#include "Arena.h"
+#include "Allocations.h"
+#include <cstdint>
+#include <cstdlib>
+
+const size_t Arena::BLOCK_SIZE = 64 * 1024;
+
+Arena::Arena() :
+	cursor(NULL),
+	limit(NULL),
+	bytesAllocated(0)
+{
+}
+
+Arena::~Arena()
+{
+	Release();
+}
+
+void Arena::NewBlock(size_t size)
+{
+	size_t blockSize = size > BLOCK_SIZE ? size : BLOCK_SIZE;
+
+	char *block = static_cast<char *>(std::malloc(blockSize));
+
+	if (block == NULL)
+	{
+		throw std::bad_alloc();
+	}
+
+	CountAllocation(blockSize);
+	blocks.push_back(block);
+	cursor = block;
+	limit = block + blockSize;
+}
+
+void *Arena::Allocate(size_t size, size_t align)
+{
+	/* Round the cursor up to the required alignment */
+	uintptr_t aligned = (reinterpret_cast<uintptr_t>(cursor) + align - 1) & ~(uintptr_t) (align - 1);
+
+	if (cursor == NULL || aligned + size > reinterpret_cast<uintptr_t>(limit))
+	{
+		/* Current block is full; malloc'ed blocks are aligned for any fundamental type */
+		NewBlock(size + align);
+		aligned = (reinterpret_cast<uintptr_t>(cursor) + align - 1) & ~(uintptr_t) (align - 1);
+	}
+
+	cursor = reinterpret_cast<char *>(aligned + size);
+	bytesAllocated += size;
+
+	return reinterpret_cast<void *>(aligned);
+}
+
+void Arena::Release()
+{
+	/* Destroy objects in reverse order, so objects are destroyed before anything they were constructed from */
+	for (auto iter = cleanups.rbegin(); iter != cleanups.rend(); iter++)
+	{
+		iter->destroy(iter->object);
+	}
+
+	for (char *block : blocks)
+	{
+		std::free(block);
+	}
+
+	cleanups.clear();
+	blocks.clear();
+	cursor = NULL;
+	limit = NULL;
+	bytesAllocated = 0;
+}
+
+void Arena::Reset()
+{
+	if (blocks.empty()) return;
+
+	for (auto iter = cleanups.rbegin(); iter != cleanups.rend(); iter++)
+	{
+		iter->destroy(iter->object);
+	}
+
+	/* Every block holds at least BLOCK_SIZE bytes, so the first block's bounds can be recomputed */
+	char *first = blocks.front();
+
+	for (size_t i = 1; i < blocks.size(); i++)
+	{
+		std::free(blocks[i]);
+	}
+
+	cleanups.clear();
+	blocks.resize(1);
+	cursor = first;
+	limit = first + BLOCK_SIZE;
+	bytesAllocated = 0;
+}
+
+size_t Arena::BytesAllocated() const
+{
+	return bytesAllocated;
+}
@@ -0,0 +1,133 @@
+#pragma once
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+/**
+* Bump allocator that owns everything allocated through it for the duration of a single compilation.
+* Objects are placed one after the other inside large blocks, so nodes created together stay close together in memory.
+* Nothing is freed individually; all objects are destroyed & all blocks are freed at once when the Arena is destroyed.
+*/
+class Arena
+{
+private:
+	/* Size of a regular block. Allocations larger than this get a dedicated block */
+	static const size_t BLOCK_SIZE;
+
+	/* An allocated object that must have its destructor called when the Arena is released */
+	struct Cleanup
+	{
+		void (*destroy)(void *object);
+		void *object;
+	};
+
+	/* All blocks owned by this Arena */
+	std::vector<char *> blocks;
+	/* Next free byte in the current block, and the end of the current block */
+	char *cursor, *limit;
+	/* Objects with non-trivial destructors, in allocation order */
+	std::vector<Cleanup> cleanups;
+	/* Total bytes handed out by this Arena */
+	size_t bytesAllocated;
+
+	/**
+	* Allocates a new block that can fit at least the given size, and makes it the current block.
+	*/
+	void NewBlock(size_t size);
+
+public:
+	Arena();
+	~Arena();
+
+	Arena(const Arena &) = delete;
+	Arena &operator=(const Arena &) = delete;
+
+	/**
+	* @param size the amount of bytes to allocate.
+	* @param align the required alignment of the allocated memory.
+	* @return pointer to uninitialized memory that lives as long as the Arena.
+	*/
+	void *Allocate(size_t size, size_t align);
+
+	/**
+	* Constructs an object of type T inside the Arena.
+	* If T isn't trivially destructible, its destructor will be called when the Arena is released.
+	*
+	* @return pointer to the new object.
+	*/
+	template <typename T, typename... Args>
+	T *New(Args&&... args)
+	{
+		T *object = new (Allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+
+		if (!std::is_trivially_destructible<T>::value)
+		{
+			cleanups.push_back(Cleanup{ [](void *ptr) { static_cast<T *>(ptr)->~T(); }, object });
+		}
+
+		return object;
+	}
+
+	/**
+	* Destroys every object allocated so far & frees all blocks.
+	*/
+	void Release();
+
+	/**
+	* Destroys every object allocated so far, but keeps the first block for the next allocations.
+	* Cheaper than Release for an Arena that's refilled over & over with small amounts of objects.
+	*/
+	void Reset();
+
+	/**
+	* @return total bytes handed out by this Arena since it was last released.
+	*/
+	size_t BytesAllocated() const;
+};
+
+/**
+* Standard allocator that takes its memory from an Arena, so standard containers can live inside it.
+* Deallocation does nothing; the memory is reclaimed together with the Arena.
+*/
+template <typename T>
+class ArenaAllocator
+{
+public:
+	using value_type = T;
+
+	Arena *arena;
+
+	ArenaAllocator(Arena *arena) :
+		arena(arena)
+	{
+	}
+
+	template <typename U>
+	ArenaAllocator(const ArenaAllocator<U> &other) :
+		arena(other.arena)
+	{
+	}
+
+	T *allocate(size_t count)
+	{
+		return static_cast<T *>(arena->Allocate(count * sizeof(T), alignof(T)));
+	}
+
+	void deallocate(T *, size_t)
+	{
+	}
+
+	template <typename U>
+	bool operator==(const ArenaAllocator<U> &other) const
+	{
+		return arena == other.arena;
+	}
+
+	template <typename U>
+	bool operator!=(const ArenaAllocator<U> &other) const
+	{
+		return arena != other.arena;
+	}
+};
@@ -0,0 +1,81 @@
+#pragma once
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <utility>
+
+/**
+* Thread-safe FIFO queue with a fixed capacity, used to hand work from a producer thread to a consumer thread.
+* Pushing blocks while the queue is full, popping blocks while the queue is empty.
+* Once closed, no more items are accepted, and consumers drain whatever is left.
+*/
+template <typename T>
+class BoundedQueue
+{
+private:
+	std::mutex mutex;
+	std::condition_variable notFull, notEmpty;
+	std::deque<T> items;
+	const size_t capacity;
+	bool closed;
+
+public:
+	BoundedQueue(size_t capacity) :
+		capacity(capacity),
+		closed(false)
+	{
+	}
+
+	/**
+	* Waits for free space & pushes given item.
+	*
+	* @return false if the queue was closed, in which case the item is dropped.
+	*/
+	bool Push(T item)
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		notFull.wait(lock, [this] { return closed || items.size() < capacity; });
+
+		if (closed)
+		{
+			return false;
+		}
+
+		items.push_back(std::move(item));
+		notEmpty.notify_one();
+		return true;
+	}
+
+	/**
+	* Waits for an item & pops it.
+	*
+	* @return false if the queue is closed & empty, in which case item is untouched.
+	*/
+	bool Pop(T &item)
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		notEmpty.wait(lock, [this] { return closed || !items.empty(); });
+
+		if (items.empty())
+		{
+			return false;
+		}
+
+		item = std::move(items.front());
+		items.pop_front();
+		notFull.notify_one();
+		return true;
+	}
+
+	/**
+	* Stops accepting items & wakes every waiting thread.
+	*/
+	void Close()
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		closed = true;
+		notFull.notify_all();
+		notEmpty.notify_all();
+	}
+};
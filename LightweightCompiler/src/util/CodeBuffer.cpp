@@ -0,0 +1,176 @@
+#include "CodeBuffer.h"
+#include <algorithm>
+
+const size_t CodeBuffer::FIRST_PAGE_SIZE = 256;
+const size_t CodeBuffer::MAX_PAGE_SIZE = 64 * 1024;
+
+CodeBuffer::CodeBuffer() :
+	cursor(NULL),
+	limit(NULL),
+	sealedBytes(0)
+{
+}
+
+CodeBuffer::CodeBuffer(CodeBuffer &&other) noexcept :
+	pages(std::move(other.pages)),
+	cursor(other.cursor),
+	limit(other.limit),
+	sealedBytes(other.sealedBytes)
+{
+	other.pages.clear();
+	other.cursor = other.limit = NULL;
+	other.sealedBytes = 0;
+}
+
+CodeBuffer &CodeBuffer::operator=(CodeBuffer &&other) noexcept
+{
+	if (this != &other)
+	{
+		Clear();
+
+		pages = std::move(other.pages);
+		cursor = other.cursor;
+		limit = other.limit;
+		sealedBytes = other.sealedBytes;
+
+		other.pages.clear();
+		other.cursor = other.limit = NULL;
+		other.sealedBytes = 0;
+	}
+
+	return *this;
+}
+
+CodeBuffer::~CodeBuffer()
+{
+	Clear();
+}
+
+void CodeBuffer::NewPage(size_t length)
+{
+	size_t capacity = FIRST_PAGE_SIZE;
+
+	if (!pages.empty())
+	{
+		/* Seal the current last page */
+		Page &last = pages.back();
+		last.length = cursor - last.data;
+		sealedBytes += last.length;
+
+		capacity = std::min(last.capacity * 2, MAX_PAGE_SIZE);
+	}
+
+	capacity = std::max(capacity, length);
+
+	pages.push_back(Page{ new char[capacity], 0, capacity });
+	cursor = pages.back().data;
+	limit = cursor + capacity;
+}
+
+void CodeBuffer::AppendSlow(std::string_view text)
+{
+	while (!text.empty())
+	{
+		if (cursor == limit) NewPage(1);
+
+		size_t length = std::min(text.length(), (size_t) (limit - cursor));
+
+		memcpy(cursor, text.data(), length);
+		cursor += length;
+		text.remove_prefix(length);
+	}
+}
+
+void CodeBuffer::AppendNumber(size_t number)
+{
+	char digits[20];
+	size_t start = sizeof(digits);
+
+	do
+	{
+		digits[--start] = (char) ('0' + number % 10);
+		number /= 10;
+	} while (number != 0);
+
+	/* Reserved, so the number is never split between pages */
+	size_t length = sizeof(digits) - start;
+	memcpy(Reserve(length), digits + start, length);
+	Advance(length);
+}
+
+void CodeBuffer::Append(CodeBuffer &&other)
+{
+	if (other.pages.empty())
+	{
+		return;
+	}
+
+	if (!pages.empty())
+	{
+		Page &last = pages.back();
+		last.length = cursor - last.data;
+		sealedBytes += last.length;
+	}
+
+	/* The other buffer's last page stays the last page, so appending continues in its free space */
+	sealedBytes += other.sealedBytes;
+	pages.insert(pages.end(), other.pages.begin(), other.pages.end());
+	cursor = other.cursor;
+	limit = other.limit;
+
+	other.pages.clear();
+	other.cursor = other.limit = NULL;
+	other.sealedBytes = 0;
+}
+
+size_t CodeBuffer::Size() const
+{
+	return pages.empty() ? 0 : sealedBytes + (cursor - pages.back().data);
+}
+
+size_t CodeBuffer::PageCount() const
+{
+	return pages.size();
+}
+
+std::string_view CodeBuffer::PageAt(size_t page) const
+{
+	const Page &selected = pages[page];
+	size_t length = page + 1 == pages.size() ? cursor - selected.data : selected.length;
+
+	return std::string_view(selected.data, length);
+}
+
+void CodeBuffer::WriteTo(std::ostream &out) const
+{
+	for (size_t i = 0; i < pages.size(); i++)
+	{
+		std::string_view page = PageAt(i);
+		out.write(page.data(), page.length());
+	}
+}
+
+std::string CodeBuffer::ToString() const
+{
+	std::string text;
+	text.reserve(Size());
+
+	for (size_t i = 0; i < pages.size(); i++)
+	{
+		text += PageAt(i);
+	}
+
+	return text;
+}
+
+void CodeBuffer::Clear()
+{
+	for (Page &page : pages)
+	{
+		delete[] page.data;
+	}
+
+	pages.clear();
+	cursor = limit = NULL;
+	sealedBytes = 0;
+}
@@ -0,0 +1,120 @@
+#pragma once
+#include <cstddef>
+#include <cstring>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+* Output buffer made of separately allocated pages, which grows without ever moving or copying what was written.
+* Pages start small & double up to a limit, so small outputs (e.g. a single block's code) stay small & large ones take few allocations.
+* Two buffers are joined by moving the pages of one to the end of the other, and a buffer is written out page by page, so the whole output never has to be a single string.
+*/
+class CodeBuffer
+{
+private:
+	/* Capacity of the first page, and the most a page grows to */
+	static const size_t FIRST_PAGE_SIZE, MAX_PAGE_SIZE;
+
+	struct Page
+	{
+		char *data;
+		/* Bytes written to the page. Not updated for the last page, whose bytes end at cursor */
+		size_t length;
+		size_t capacity;
+	};
+
+	std::vector<Page> pages;
+	/* Free space of the last page */
+	char *cursor, *limit;
+	/* Bytes written to every page but the last */
+	size_t sealedBytes;
+
+	/**
+	* Adds a page that fits at least given amount of bytes & makes it the last page.
+	*/
+	void NewPage(size_t length);
+	void AppendSlow(std::string_view text);
+
+public:
+	CodeBuffer();
+	CodeBuffer(CodeBuffer &&other) noexcept;
+	CodeBuffer &operator=(CodeBuffer &&other) noexcept;
+	~CodeBuffer();
+
+	CodeBuffer(const CodeBuffer &) = delete;
+	CodeBuffer &operator=(const CodeBuffer &) = delete;
+
+	void Append(std::string_view text)
+	{
+		if (text.length() < (size_t) (limit - cursor))
+		{
+			memcpy(cursor, text.data(), text.length());
+			cursor += text.length();
+			return;
+		}
+
+		AppendSlow(text);
+	}
+
+	void Append(char c)
+	{
+		if (cursor == limit) NewPage(1);
+		*cursor++ = c;
+	}
+
+	/**
+	* Appends the decimal digits of given number.
+	*/
+	void AppendNumber(size_t number);
+
+	/**
+	* Moves every page of given buffer to the end of this one, without copying them. The other buffer is left empty.
+	*/
+	void Append(CodeBuffer &&other);
+
+	/**
+	* Gets contiguous space for given amount of bytes, which are then written directly & committed with Advance.
+	* Text written this way is never split between pages.
+	*
+	* @param length the most bytes that will be written; at most the largest page's capacity.
+	* @return where to write.
+	*/
+	char *Reserve(size_t length)
+	{
+		if ((size_t) (limit - cursor) < length) NewPage(length);
+		return cursor;
+	}
+
+	/**
+	* Commits given amount of bytes written to the space returned by Reserve.
+	*/
+	void Advance(size_t length)
+	{
+		cursor += length;
+	}
+
+	/**
+	* @return the amount of bytes written.
+	*/
+	size_t Size() const;
+	size_t PageCount() const;
+	/**
+	* @return the bytes written to given page. Pages are in writing order.
+	*/
+	std::string_view PageAt(size_t page) const;
+
+	/**
+	* Writes the whole buffer to given stream, page by page.
+	*/
+	void WriteTo(std::ostream &out) const;
+	/**
+	* Copies the whole buffer into a single string.
+	*/
+	std::string ToString() const;
+	/**
+	* Frees every page.
+	*/
+	void Clear();
+};
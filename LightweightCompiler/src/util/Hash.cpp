@@ -0,0 +1,60 @@
+#include "Hash.h"
+#include <cstring>
+
+uint64_t HashBytes(std::string_view data, uint64_t seed)
+{
+	const uint64_t multiplier = 0xc6a4a7935bd1e995ULL;
+	const int shift = 47;
+
+	uint64_t hash = seed ^ (data.length() * multiplier);
+
+	const char *bytes = data.data();
+	const char *wordsEnd = bytes + (data.length() & ~(size_t) 7);
+
+	for (; bytes != wordsEnd; bytes += 8)
+	{
+		/* memcpy instead of a cast, as the data isn't necessarily aligned */
+		uint64_t word;
+		memcpy(&word, bytes, 8);
+
+		word *= multiplier;
+		word ^= word >> shift;
+		word *= multiplier;
+
+		hash ^= word;
+		hash *= multiplier;
+	}
+
+	/* Mix the remaining bytes in */
+	size_t remaining = data.length() & 7;
+
+	if (remaining != 0)
+	{
+		for (size_t i = remaining; i > 0; i--)
+		{
+			hash ^= (uint64_t) (unsigned char) bytes[i - 1] << ((i - 1) * 8);
+		}
+
+		hash *= multiplier;
+	}
+
+	hash ^= hash >> shift;
+	hash *= multiplier;
+	hash ^= hash >> shift;
+
+	return hash;
+}
+
+std::string HashToHex(uint64_t hash)
+{
+	static const char digits[] = "0123456789abcdef";
+	std::string hex(16, '0');
+
+	for (size_t i = 16; i > 0; i--)
+	{
+		hex[i - 1] = digits[hash & 0xf];
+		hash >>= 4;
+	}
+
+	return hex;
+}
@@ -0,0 +1,18 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+/**
+* Fast non-cryptographic 64-bit hash (MurmurHash64A). Reads the data 8 bytes at a time.
+*
+* @param data the bytes to hash.
+* @param seed starting value; hashing with a previous hash as the seed chains several inputs into a single hash.
+* @return the hash of given bytes.
+*/
+uint64_t HashBytes(std::string_view data, uint64_t seed = 0);
+
+/**
+* @return given hash as 16 lowercase hex digits, usable as a file name.
+*/
+std::string HashToHex(uint64_t hash);
@@ -0,0 +1,129 @@
+#include "MappedFile.h"
+#include <cstdlib>
+#include <iostream>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+/**
+* Reports a file that couldn't be mapped & exits.
+*/
+static void MappingError(const std::string &filePath)
+{
+	std::cout << "Could not map " << filePath << ".";
+	exit(1);
+}
+
+#ifdef _WIN32
+
+MappedFile::MappedFile(const std::string &filePath) :
+	data(NULL),
+	size(0),
+	fileHandle(INVALID_HANDLE_VALUE),
+	mappingHandle(NULL)
+{
+	fileHandle = CreateFileA(filePath.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+
+	if (fileHandle == INVALID_HANDLE_VALUE)
+	{
+		MappingError(filePath);
+	}
+
+	LARGE_INTEGER fileSize;
+
+	if (!GetFileSizeEx(fileHandle, &fileSize))
+	{
+		MappingError(filePath);
+	}
+
+	size = (size_t) fileSize.QuadPart;
+
+	/* Empty files can't be mapped, and there's nothing to view anyway */
+	if (size == 0)
+	{
+		return;
+	}
+
+	mappingHandle = CreateFileMappingA(fileHandle, NULL, PAGE_READONLY, 0, 0, NULL);
+
+	if (mappingHandle == NULL)
+	{
+		MappingError(filePath);
+	}
+
+	data = static_cast<const char *>(MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0));
+
+	if (data == NULL)
+	{
+		MappingError(filePath);
+	}
+}
+
+MappedFile::~MappedFile()
+{
+	if (data != NULL) UnmapViewOfFile(data);
+	if (mappingHandle != NULL) CloseHandle(mappingHandle);
+	if (fileHandle != INVALID_HANDLE_VALUE) CloseHandle(fileHandle);
+}
+
+#else
+
+MappedFile::MappedFile(const std::string &filePath) :
+	data(NULL),
+	size(0),
+	fileDescriptor(-1)
+{
+	fileDescriptor = open(filePath.c_str(), O_RDONLY);
+
+	if (fileDescriptor < 0)
+	{
+		MappingError(filePath);
+	}
+
+	struct stat fileStat;
+
+	if (fstat(fileDescriptor, &fileStat) != 0)
+	{
+		MappingError(filePath);
+	}
+
+	size = (size_t) fileStat.st_size;
+
+	/* Empty files can't be mapped, and there's nothing to view anyway */
+	if (size == 0)
+	{
+		return;
+	}
+
+	void *mapped = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fileDescriptor, 0);
+
+	if (mapped == MAP_FAILED)
+	{
+		MappingError(filePath);
+	}
+
+	/* The Tokenizer reads the file front to back exactly once */
+	madvise(mapped, size, MADV_SEQUENTIAL);
+
+	data = static_cast<const char *>(mapped);
+}
+
+MappedFile::~MappedFile()
+{
+	if (data != NULL) munmap(const_cast<char *>(data), size);
+	if (fileDescriptor >= 0) close(fileDescriptor);
+}
+
+#endif
+
+std::string_view MappedFile::View() const
+{
+	return std::string_view(data, size);
+}
@@ -0,0 +1,39 @@
+#pragma once
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+/**
+* Read-only memory mapping of an entire file.
+* The file's contents are viewed directly from the mapped pages; nothing is copied into process memory.
+* The view is valid for as long as the MappedFile lives.
+*/
+class MappedFile
+{
+private:
+	/* Start of the mapped contents. Null for an empty file */
+	const char *data;
+	size_t size;
+
+#ifdef _WIN32
+	void *fileHandle;
+	void *mappingHandle;
+#else
+	int fileDescriptor;
+#endif
+
+public:
+	/**
+	* Maps given file into memory. Exits if the file can't be opened or mapped.
+	*/
+	MappedFile(const std::string &filePath);
+	~MappedFile();
+
+	MappedFile(const MappedFile &) = delete;
+	MappedFile &operator=(const MappedFile &) = delete;
+
+	/**
+	* @return view of the file's contents.
+	*/
+	std::string_view View() const;
+};
@@ -0,0 +1,149 @@
+#include "Profiler.h"
+#include "Allocations.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+/**
+* @return the CPU time used by the process so far, in milliseconds.
+* On POSIX, this includes the child processes that were waited for. On Windows, child processes aren't included.
+*/
+static double CpuMs()
+{
+#ifdef _WIN32
+	FILETIME creation, exit, kernel, user;
+	GetProcessTimes(GetCurrentProcess(), &creation, &exit, &kernel, &user);
+
+	/* FILETIMEs count 100ns intervals */
+	auto toMs = [](const FILETIME &time) { return (((uint64_t) time.dwHighDateTime << 32) | time.dwLowDateTime) / 10000.0; };
+
+	return toMs(kernel) + toMs(user);
+#else
+	auto toMs = [](const timeval &time) { return time.tv_sec * 1000.0 + time.tv_usec / 1000.0; };
+
+	rusage self, children;
+	getrusage(RUSAGE_SELF, &self);
+	getrusage(RUSAGE_CHILDREN, &children);
+
+	return toMs(self.ru_utime) + toMs(self.ru_stime) + toMs(children.ru_utime) + toMs(children.ru_stime);
+#endif
+}
+
+/**
+* @return the peak resident memory of the process so far, in bytes.
+*/
+static uint64_t PeakRssBytes()
+{
+#ifdef _WIN32
+	PROCESS_MEMORY_COUNTERS counters;
+	GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters));
+
+	return counters.PeakWorkingSetSize;
+#else
+	rusage self;
+	getrusage(RUSAGE_SELF, &self);
+
+#ifdef __APPLE__
+	return self.ru_maxrss;
+#else
+	/* Reported in KB */
+	return (uint64_t) self.ru_maxrss * 1024;
+#endif
+#endif
+}
+
+Profiler::Phase::Phase(Profiler *profiler, const std::string &name) :
+	profiler(profiler),
+	name(name)
+{
+	if (profiler == NULL)
+	{
+		return;
+	}
+
+	Allocations allocations = AllocationsSoFar();
+
+	allocationsStart = allocations.count;
+	allocatedBytesStart = allocations.bytes;
+	cpuStart = CpuMs();
+	wallStart = std::chrono::steady_clock::now();
+}
+
+Profiler::Phase::~Phase()
+{
+	End();
+}
+
+void Profiler::Phase::End()
+{
+	if (profiler == NULL)
+	{
+		return;
+	}
+
+	auto wallEnd = std::chrono::steady_clock::now();
+	double cpuEnd = CpuMs();
+	Allocations allocations = AllocationsSoFar();
+
+	PhaseProfile phase{
+		name,
+		std::chrono::duration<double, std::milli>(wallEnd - wallStart).count(),
+		cpuEnd - cpuStart,
+		allocations.count - allocationsStart,
+		allocations.bytes - allocatedBytesStart,
+		PeakRssBytes(),
+	};
+
+	std::lock_guard<std::mutex> lock(profiler->mutex);
+	profiler->phases.push_back(std::move(phase));
+
+	profiler = NULL;
+}
+
+void Profiler::Add(const std::string &counter, uint64_t amount)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+
+	for (auto &existing : counters)
+	{
+		if (existing.first == counter)
+		{
+			existing.second += amount;
+			return;
+		}
+	}
+
+	counters.emplace_back(counter, amount);
+}
+
+void Profiler::WriteJson(std::ostream &out)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+
+	/* Names are identifiers chosen by the compiler, so they need no escaping */
+	out << "{\n  \"phases\": [";
+
+	for (size_t i = 0; i < phases.size(); i++)
+	{
+		const PhaseProfile &phase = phases[i];
+
+		out << (i == 0 ? "\n" : ",\n")
+			<< "    {\"name\": \"" << phase.name << "\", \"wallMs\": " << phase.wallMs << ", \"cpuMs\": " << phase.cpuMs
+			<< ", \"allocations\": " << phase.allocations << ", \"allocatedBytes\": " << phase.allocatedBytes
+			<< ", \"peakRssBytes\": " << phase.peakRssBytes << "}";
+	}
+
+	out << "\n  ],\n  \"counters\": {";
+
+	for (size_t i = 0; i < counters.size(); i++)
+	{
+		out << (i == 0 ? "\n" : ",\n") << "    \"" << counters[i].first << "\": " << counters[i].second;
+	}
+
+	out << "\n  }\n}\n";
+}
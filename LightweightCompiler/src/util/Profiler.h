@@ -0,0 +1,73 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+/* Time & memory use of a single phase of a build */
+struct PhaseProfile
+{
+	std::string name;
+	/* Elapsed time, and CPU time of all threads of the process (and of the child processes it waited for, where the platform reports them) */
+	double wallMs, cpuMs;
+	/* Heap allocations made during the phase, by all threads */
+	uint64_t allocations, allocatedBytes;
+	/* Peak resident memory of the process, by the end of the phase */
+	uint64_t peakRssBytes;
+};
+
+/**
+* Collects the phases & counters of a build, to be written as JSON.
+* Phases are measured by Phase objects. Counters can be added from any thread.
+*/
+class Profiler
+{
+private:
+	std::mutex mutex;
+	/* Phases in the order they ended */
+	std::vector<PhaseProfile> phases;
+	/* Counters in the order they were first added */
+	std::vector<std::pair<std::string, uint64_t>> counters;
+
+public:
+	/**
+	* Measures a phase from its construction to its destruction. Phases may nest.
+	*/
+	class Phase
+	{
+	private:
+		Profiler *profiler;
+		std::string name;
+		std::chrono::steady_clock::time_point wallStart;
+		double cpuStart;
+		uint64_t allocationsStart, allocatedBytesStart;
+
+	public:
+		/**
+		* @param profiler receives the phase once it ends, or NULL to measure nothing.
+		*/
+		Phase(Profiler *profiler, const std::string &name);
+		/**
+		* Ends the phase, unless it was ended already.
+		*/
+		~Phase();
+
+		/**
+		* Ends the phase before the Phase object goes out of scope.
+		*/
+		void End();
+	};
+
+	/**
+	* Adds given amount to the counter with given name. The counter starts at 0.
+	*/
+	void Add(const std::string &counter, uint64_t amount);
+
+	/**
+	* Writes the phases & counters as a JSON object:
+	* {"phases": [{"name", "wallMs", "cpuMs", "allocations", "allocatedBytes", "peakRssBytes"}, ...], "counters": {name: value, ...}}
+	*/
+	void WriteJson(std::ostream &out);
+};
@@ -0,0 +1,136 @@
+#include "ThreadPool.h"
+#include <algorithm>
+#include <utility>
+
+ThreadPool::ThreadPool(size_t workerCount) :
+	unfinished(0),
+	submitted(0),
+	errorTask(0),
+	stopping(false)
+{
+	if (workerCount == 0)
+	{
+		/* hardware_concurrency may be unknown, which is reported as 0 */
+		workerCount = std::thread::hardware_concurrency();
+		if (workerCount == 0) workerCount = 1;
+	}
+
+	workers.reserve(workerCount);
+
+	for (size_t i = 0; i < workerCount; i++)
+	{
+		workers.emplace_back(&ThreadPool::Work, this);
+	}
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		tasksDone.wait(lock, [this] { return unfinished == 0; });
+
+		stopping = true;
+		taskReady.notify_all();
+	}
+
+	for (std::thread &worker : workers)
+	{
+		worker.join();
+	}
+}
+
+void ThreadPool::Work()
+{
+	while (true)
+	{
+		std::pair<size_t, std::function<void()>> task;
+
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			taskReady.wait(lock, [this] { return stopping || !tasks.empty(); });
+
+			if (tasks.empty())
+			{
+				return;
+			}
+
+			task = std::move(tasks.front());
+			tasks.pop_front();
+		}
+
+		std::exception_ptr taskError;
+
+		try
+		{
+			task.second();
+		}
+		catch (...)
+		{
+			taskError = std::current_exception();
+		}
+
+		std::lock_guard<std::mutex> lock(mutex);
+
+		if (taskError && (!error || task.first < errorTask))
+		{
+			error = taskError;
+			errorTask = task.first;
+		}
+
+		if (--unfinished == 0)
+		{
+			tasksDone.notify_all();
+		}
+	}
+}
+
+void ThreadPool::Submit(std::function<void()> task)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+
+	tasks.emplace_back(submitted++, std::move(task));
+	unfinished++;
+	taskReady.notify_one();
+}
+
+void ThreadPool::Wait()
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	tasksDone.wait(lock, [this] { return unfinished == 0; });
+
+	if (error)
+	{
+		std::exception_ptr taskError = error;
+		error = std::exception_ptr();
+		std::rethrow_exception(taskError);
+	}
+}
+
+size_t ThreadPool::WorkerCount() const
+{
+	return workers.size();
+}
+
+/* Ranges per worker of ForEachRange */
+static const size_t RANGES_PER_WORKER = 4;
+
+void ForEachRange(ThreadPool *pool, size_t count, const std::function<void(size_t begin, size_t end)> &task)
+{
+	if (pool == NULL || pool->WorkerCount() <= 1 || count <= 1)
+	{
+		task(0, count);
+		return;
+	}
+
+	size_t rangeCount = std::min(count, pool->WorkerCount() * RANGES_PER_WORKER);
+
+	for (size_t i = 0; i < rangeCount; i++)
+	{
+		pool->Submit([&task, count, rangeCount, i]
+		{
+			task(count * i / rangeCount, count * (i + 1) / rangeCount);
+		});
+	}
+
+	pool->Wait();
+}
@@ -0,0 +1,74 @@
+#pragma once
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+* Fixed set of worker threads that run submitted tasks in submission order.
+* Tasks of a single phase are submitted together & waited for together, so a pool can be reused by every parallel phase of a compilation.
+* An exception thrown by a task is rethrown by Wait. If several tasks throw, the one that was submitted first wins, so errors are reported in the same order as when running the tasks serially.
+*/
+class ThreadPool
+{
+private:
+	std::vector<std::thread> workers;
+	std::mutex mutex;
+	std::condition_variable taskReady, tasksDone;
+	/* Tasks that weren't picked up by a worker yet, with their submission index */
+	std::deque<std::pair<size_t, std::function<void()>>> tasks;
+	/* Submitted tasks that didn't finish yet, including the running ones */
+	size_t unfinished;
+	/* Submission index of the next task */
+	size_t submitted;
+	/* Exception of the earliest submitted task that threw since the last Wait, and that task's submission index */
+	std::exception_ptr error;
+	size_t errorTask;
+	bool stopping;
+
+	/**
+	* Worker thread's entry point. Runs queued tasks until the pool is destroyed.
+	*/
+	void Work();
+
+public:
+	/**
+	* Starts given amount of workers, or one per hardware thread if it's 0.
+	*/
+	ThreadPool(size_t workerCount = 0);
+	/**
+	* Waits for the queued tasks & stops the workers. Exceptions of those tasks are discarded.
+	*/
+	~ThreadPool();
+
+	ThreadPool(const ThreadPool &) = delete;
+	ThreadPool &operator=(const ThreadPool &) = delete;
+
+	/**
+	* Queues given task for the next free worker.
+	*/
+	void Submit(std::function<void()> task);
+	/**
+	* Waits until every submitted task has finished.
+	* If any of them threw, rethrows the exception of the earliest submitted one.
+	* Must not be called from a task of the same pool.
+	*/
+	void Wait();
+	/**
+	* @return the amount of worker threads.
+	*/
+	size_t WorkerCount() const;
+};
+
+/**
+* Splits [0, count) into consecutive ranges & runs given task on every range, on the pool's workers. Returns once all ranges are done.
+* Every worker gets a few ranges, so workers that finish cheap ranges early pick up more, while the amount of tasks stays small for large counts.
+*
+* @param pool the workers, or NULL to run the task over the whole range on the calling thread.
+* @param task receives the first index of its range, and the one after its last.
+*/
+void ForEachRange(ThreadPool *pool, size_t count, const std::function<void(size_t begin, size_t end)> &task);
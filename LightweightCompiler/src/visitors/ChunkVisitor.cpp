@@ -0,0 +1,44 @@
+#include "../compiler/Compiler.h"
+
+ChunkVisitor::ChunkVisitor(CompileContext *context, const TopLevelScope &scope, size_t chunk, ChunkImports &imports) :
+	StatementVisitor(context),
+	scope(scope),
+	chunk(chunk),
+	imports(imports)
+{
+}
+
+Var *ChunkVisitor::Import(const Token *id) const
+{
+	auto iterator = scope.firstDeclarations.find(id->literal);
+
+	if (iterator == scope.firstDeclarations.end() || scope.vars[iterator->second].chunk >= chunk)
+	{
+		imports.missing.push_back(id->literal);
+		return NULL;
+	}
+
+	const TopLevelVar &declaration = scope.vars[iterator->second];
+	Token type{ declaration.type, "" };
+
+	imports.declarations.push_back(iterator->second);
+	return varTable->Import(declaration.id, typeTable->GetType(&type), imports.declarations.size() - 1);
+}
+
+Var *ChunkVisitor::GetVar(const Token *id) const
+{
+	Var *var = varTable->Get(id);
+
+	if (var == NULL)
+	{
+		return Import(id);
+	}
+
+	return var;
+}
+
+void ChunkVisitor::Visit(const InitExpr *expr)
+{
+	GetVar(expr->id);
+	StatementVisitor::Visit(expr);
+}
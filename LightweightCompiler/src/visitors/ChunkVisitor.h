@@ -0,0 +1,67 @@
+#pragma once
+#include "StatementVisitor.h"
+#include <unordered_map>
+#include <vector>
+
+/* A variable declared in the top-level scope, found before the top-level statements are compiled in parallel */
+struct TopLevelVar
+{
+	VarId id;
+	/* The declared type's TokenType (TYPE_INT, TYPE_BOOL, etc) */
+	TokenType type;
+	/* Chunk of top-level statements that declares the variable */
+	size_t chunk;
+};
+
+/* Every variable declared in the top-level scope, in declaration order */
+struct TopLevelScope
+{
+	std::vector<TopLevelVar> vars;
+	/* Index of the first declaration of every top-level variable */
+	std::unordered_map<VarId, size_t> firstDeclarations;
+};
+
+/* Top-level names a chunk looked up outside of itself. The chunk's code is the same wherever it's placed, as long as these resolve the same way */
+struct ChunkImports
+{
+	/* Declarations of the variables the chunk imported, in import order. The chunk's code refers to imported variables by their position in it */
+	std::vector<size_t> declarations;
+	/* Names the chunk looked up that no earlier chunk declares */
+	std::vector<VarId> missing;
+};
+
+/**
+* The ChunkVisitor is the first StatementVisitor of a chunk of top-level statements that's compiled separately from the statements before it.
+* Top-level variables that were declared by earlier chunks are imported on their first use, and their offsets are resolved once all chunks are compiled.
+*/
+class ChunkVisitor : public StatementVisitor
+{
+private:
+	const TopLevelScope &scope;
+	/* Index of the compiled chunk */
+	const size_t chunk;
+	/* Receives every name the chunk looks up in earlier chunks */
+	ChunkImports &imports;
+
+	/**
+	* Imports given variable if an earlier chunk declares it.
+	*
+	* @return the imported variable, or NULL if no earlier chunk declares it.
+	*/
+	Var *Import(const Token *id) const;
+
+public:
+	/**
+	* @param context the chunk's compilation. Its ASMGenerator must be relocatable.
+	*/
+	ChunkVisitor(CompileContext *context, const TopLevelScope &scope, size_t chunk, ChunkImports &imports);
+
+	/**
+	* Get Variable from VarTable, or import it from an earlier chunk.
+	*/
+	Var *GetVar(const Token *id) const override;
+	/**
+	* Imports variables that are declared again before adding them, so they're rejected as they would be if all chunks were compiled together.
+	*/
+	void Visit(const InitExpr *expr) override;
+};
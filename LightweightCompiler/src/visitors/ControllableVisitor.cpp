@@ -1,6 +1,6 @@
 #include "../compiler/Compiler.h"
 
-ControllableVisitor::ControllableVisitor(StatementVisitor *superVisitor, const std::string labelEnter, const std::string labelExit) :
+ControllableVisitor::ControllableVisitor(StatementVisitor *superVisitor, ASMLabel labelEnter, ASMLabel labelExit) :
 	StatementVisitor(superVisitor),
 	labelEnter(labelEnter),
 	labelExit(labelExit)
@@ -24,11 +24,11 @@ void ControllableVisitor::Visit(const ControlFlowExpr *expr)
 	switch (expr->stmt->type)
 	{
 	case TokenType::BREAK:
-		asmGen->AppendLine("JMP " + labelExit + " ; break");
+		asmGen->Append(ASMInstr::JMP, labelExit, "; break");
 		break;
 
 	case TokenType::CONTINUE:
-		asmGen->AppendLine("JMP " + labelEnter + " ; continue");
+		asmGen->Append(ASMInstr::JMP, labelEnter, "; continue");
 		break;
 	}
 }
\ No newline at end of file
@@ -11,13 +11,13 @@ class ControllableVisitor : public StatementVisitor
 {
 private:
 	/* Each Controllable expression has an enter & exit label, so they can be controlled with continue/break statements */
-	const std::string labelEnter, labelExit;
+	const ASMLabel labelEnter, labelExit;
 
 public:
 	/**
 	* A ControllableVisitor is constructed with its calling BaseVisitor & its Controllable expression's enter & exit labels.
 	*/
-	ControllableVisitor(StatementVisitor *superVisitor, const std::string labelEnter, const std::string labelExit);
+	ControllableVisitor(StatementVisitor *superVisitor, ASMLabel labelEnter, ASMLabel labelExit);
 	/**
 	* Get Variable from VarTable.
 	* This overrides StatementVisitor's GetVar() to allow getting variables from outer scopes.
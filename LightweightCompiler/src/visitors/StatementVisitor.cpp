@@ -1,15 +1,27 @@
 #include "../compiler/Compiler.h"
 
-StatementVisitor::StatementVisitor(StatementVisitor *superVisitor) :
+/* Registers that loops keep variables in, in the order they're taken. The print routines preserve them, like any cdecl routine.
+* ebx is last, as expressions may use it when no loop does */
+static const ASMReg LOOP_REGS[] = { ASMReg::ESI, ASMReg::EDI, ASMReg::EBX };
+
+StatementVisitor::StatementVisitor(StatementVisitor *superVisitor, CompileContext *context) :
 	ChildVisitor(superVisitor),
-	asmGen(ASMGenerator::GetInstance()),
-	varTable(new VarTable()),
-	valueVisitor(new ValueVisitor(this))
+	context(context),
+	arena(&context->arena),
+	varTable(arena->New<VarTable>(arena, &context->stackBytes)),
+	typeTable(arena->New<TypeTable>()),
+	valueVisitor(arena->New<ValueVisitor>(this, &context->asmGen, &context->loopRegs)),
+	asmGen(&context->asmGen)
 {
 }
 
-StatementVisitor::StatementVisitor() :
-	StatementVisitor(NULL)
+StatementVisitor::StatementVisitor(StatementVisitor *superVisitor) :
+	StatementVisitor(superVisitor, superVisitor->context)
+{
+}
+
+StatementVisitor::StatementVisitor(CompileContext *context) :
+	StatementVisitor(NULL, context)
 {
 }
 
@@ -33,60 +45,60 @@ Var *StatementVisitor::GetVar(const Token *id) const
 void StatementVisitor::Visit(const LitExpr *expr)
 {
 	/* Let ValueVisitor evaluate */
-	expr->Accept(valueVisitor);
+	valueVisitor->Evaluate(expr);
 }
 
 void StatementVisitor::Visit(const UnaryExpr *expr)
 {
 	/* Let ValueVisitor evaluate */
-	expr->Accept(valueVisitor);
+	valueVisitor->Evaluate(expr);
 }
 
 void StatementVisitor::Visit(const BinaryExpr *expr)
 {
 	/* Let ValueVisitor evaluate */
-	expr->Accept(valueVisitor);
+	valueVisitor->Evaluate(expr);
 }
 
 void StatementVisitor::Visit(const GroupExpr *expr)
 {
 	/* Let ValueVisitor evaluate */
-	expr->Accept(valueVisitor);
+	valueVisitor->Evaluate(expr);
 }
 
 void StatementVisitor::Visit(const TernExpr *expr)
 {
 	/* Let ValueVisitor evaluate */
-	expr->Accept(valueVisitor);
+	valueVisitor->Evaluate(expr);
 }
 
 void StatementVisitor::Visit(const CondExpr *expr)
 {
 	/* Let ValueVisitor evaluate */
-	expr->Accept(valueVisitor);
+	valueVisitor->Evaluate(expr);
 }
 
 void StatementVisitor::Visit(const AccessibleExpr *expr)
 {
 	/* Let ValueVisitor evaluate */
-	expr->Accept(valueVisitor);
+	valueVisitor->Evaluate(expr);
 }
 
 void StatementVisitor::Visit(const PrintExpr *expr)
 {
 	/* Evaluate & save print value */
-	expr->value->Accept(valueVisitor);
+	valueVisitor->Evaluate(expr->value);
 
 	const Type *type = valueVisitor->GetType();
 
 	if (type == TypeTable::TYPE_BOOL)
 	{
-		asmGen->AppendLine("CALL print_bool");
+		asmGen->Append(ASMInstr::CALL, ASMSymbol::PRINT_BOOL);
 		return;
 	}
 
 	/* Value is stored in stack, just call print function */
-	asmGen->AppendLine("CALL print_number");
+	asmGen->Append(ASMInstr::CALL, ASMSymbol::PRINT_NUMBER);
 }
 
 void StatementVisitor::Visit(const AssignExpr *expr)
@@ -98,47 +110,47 @@ void StatementVisitor::Visit(const AssignExpr *expr)
 
 	if (var == NULL)
 	{
-		ThrowCompileError(id->literal + " is undefined.");
+		ThrowCompileError(std::string(id->literal) + " is undefined.");
 	}
 
-	/* Evaluating the variable's value. This will lead to ValueVisitor evaluating the value. */
-	expr->value->Accept(this);
-	asmGen->AppendComment("Evaluated variable value, pushed to stack");
-
-	/* Get in advance the pointer for the variable's value */
+	/* Get in advance the variable's memory, or the register that a loop keeps it in */
 	// we need to add 4 to this or it doesn't work?
-	std::string valPointer = "DWORD [ebp-" + std::to_string(var->memOffset) + "]";
+	ASMOperand target = asmGen->VarOperand(var);
+	/* Instructions take at most 1 memory operand */
+	bool memory = target.kind != ASMOperand::MEM;
 
 	switch (expr->assignOper->type)
 	{
 	case TokenType::EQ:
-		asmGen->AppendLine("POP " + valPointer);
+		asmGen->Append(ASMInstr::MOV, target, valueVisitor->EvaluateOperand(expr->value, memory));
 		break;
 
 	case TokenType::EQ_ADD:
-		asmGen->AppendLine("POP eax");
-		asmGen->AppendLine("ADD " + valPointer + ", eax");
+		asmGen->Append(ASMInstr::ADD, target, valueVisitor->EvaluateOperand(expr->value, memory));
 		break;
 
 	case TokenType::EQ_SUB:
-		asmGen->AppendLine("POP eax");
-		asmGen->AppendLine("SUB " + valPointer + ", eax");
+		asmGen->Append(ASMInstr::SUB, target, valueVisitor->EvaluateOperand(expr->value, memory));
 		break;
 
 	case TokenType::EQ_MULT:
+		/* Evaluating the variable's value. This will lead to ValueVisitor evaluating the value. */
 		expr->value->Accept(this);
-		asmGen->AppendLine("PUSH " + valPointer);
+		asmGen->Append(ASMInstr::PUSH, target);
 		asmGen->AppendBinary(ASMInstr::IMUL);
-		asmGen->AppendLine("POP " + valPointer);
+		asmGen->Append(ASMInstr::POP, target);
 		break;
 
 	case TokenType::EQ_DIV:
-		expr->value->Accept(this);
-		asmGen->AppendLine("PUSH " + valPointer);
-		asmGen->AppendBinary(ASMInstr::IDIV);
-		asmGen->AppendLine("POP " + valPointer);
+	{
+		/* Evaluated as the division var / value, so it divides exactly like the / operator does */
+		Token divide{ TokenType::DIV, "/" };
+		BinaryExpr division(expr->var, expr->value, &divide);
+
+		asmGen->Append(ASMInstr::MOV, target, valueVisitor->EvaluateOperand(&division, memory));
 		break;
 	}
+	}
 
 	asmGen->AppendSpace();
 }
@@ -162,7 +174,7 @@ void StatementVisitor::Visit(const InitExpr *expr)
 		/* Evaluating the variable's value. This will lead to ValueVisitor evaluating the value. */
 		expr->assign->value->Accept(this);
 		asmGen->AppendComment("Evaluated variable value, saving to eax");
-		asmGen->AppendLine("POP eax");
+		asmGen->Append(ASMInstr::POP, ASMReg::EAX);
 
 		/* Save the evaluated value's Type, as it is the new variable's Type*/
 		const Type *evalType = valueVisitor->GetType();
@@ -184,79 +196,76 @@ void StatementVisitor::Visit(const InitExpr *expr)
 
 	if (var == NULL)
 	{
-		ThrowCompileError(id->literal + " is already defined within this scope.");
+		ThrowCompileError(std::string(id->literal) + " is already defined within this scope.");
 	}
 
 	/* Allocate stack memory for the new variable */
-	asmGen->AppendLine("SUB esp, " + std::to_string(var->type->size)); // Allocate memory for variable
+	asmGen->Append(ASMInstr::SUB, ASMReg::ESP, ASMOperand::Imm((int32_t) var->type->size)); // Allocate memory for variable
 
 	if (expr->assign != NULL)
 	{
-		std::string ptrType;
-		std::string regSegment;
+		ASMSize ptrType = ASMSize::DWORD;
+		ASMReg regSegment = ASMReg::EAX;
 
 		switch (var->type->size)
 		{
 		case 4:
-			ptrType = "DWORD";
-			regSegment = "eax";
+			ptrType = ASMSize::DWORD;
+			regSegment = ASMReg::EAX;
 			break;
 
 		case 2:
-			ptrType = "WORD";
-			regSegment = "ax";
+			ptrType = ASMSize::WORD;
+			regSegment = ASMReg::AX;
 			break;
 
 		case 1:
-			ptrType = "BYTE";
-			regSegment = "al";
+			ptrType = ASMSize::BYTE;
+			regSegment = ASMReg::AL;
 			break;
 		}
 
 		/* Get in advance the pointer for the variable's value */
 		// we need to add 4 to this or it doesn't work? (half a year after starting this project, I still don't understand why I left this comment)
-		std::string valPointer = "[ebp-" + std::to_string(var->memOffset) + "]";
-
-		asmGen->AppendLine("MOV " + ptrType + ' ' + valPointer + ", " + regSegment);
+		asmGen->Append(ASMInstr::MOV, ASMOperand::Mem(ptrType, asmGen->StackOffset(var)), regSegment);
 	}
 
 	asmGen->AppendSpace();
 }
 
-void StatementVisitor::VisitCondition(const IfExpr *expr, std::string &exitLabel)
+void StatementVisitor::VisitCondition(const IfExpr *expr, ASMLabel exitLabel)
 {
-	std::string falseLabel = asmGen->GenerateLabel(); // Incase cond is false
-
-	expr->cond->Accept(this); // Pushes condition result into stack
+	/* Walk the elif chain in a loop, so long chains don't nest native calls */
+	for (; expr != NULL; expr = expr->elif)
+	{
+		ASMLabel falseLabel = asmGen->GenerateLabel(); // Incase cond is false
 
-	asmGen->AppendLine("POP eax ;; Save condition result");
-	asmGen->AppendLine("CMP eax, 0");
-	asmGen->AppendLine("JZ " + falseLabel + " ;; If conditin is false, jump to false label");
-	asmGen->AppendSpace();
+		valueVisitor->Branch(expr->cond, falseLabel); // Jumps to false label if the condition is false
+		asmGen->AppendSpace();
 
-	StatementVisitor *ifVisitor = new StatementVisitor(this);
-	expr->block->Accept(ifVisitor);
+		StatementVisitor *ifVisitor = arena->New<StatementVisitor>(this);
+		expr->block->Accept(ifVisitor);
 
-	asmGen->AppendLine("JMP " + exitLabel);
-	asmGen->AppendLine(falseLabel + ":");
-	if (expr->elif != NULL) VisitCondition(expr->elif, exitLabel);
+		asmGen->Append(ASMInstr::JMP, exitLabel);
+		asmGen->AppendLabel(falseLabel);
+	}
 }
 
 void StatementVisitor::Visit(const IfExpr *expr)
 {
-	std::string exitLabel = asmGen->GenerateLabel();
+	ASMLabel exitLabel = asmGen->GenerateLabel();
 
 	VisitCondition(expr, exitLabel);
-	asmGen->AppendLine(exitLabel + ":");
+	asmGen->AppendLabel(exitLabel);
 }
 
 void StatementVisitor::Visit(const ElseExpr *expr)
 {
-	std::string exitLabel = asmGen->GenerateLabel();
+	ASMLabel exitLabel = asmGen->GenerateLabel();
 
 	VisitCondition(expr->ifExpr, exitLabel);
 	Visit(expr->ifExpr);
-	asmGen->AppendLine(exitLabel + ":");
+	asmGen->AppendLabel(exitLabel);
 }
 
 void StatementVisitor::Visit(const ControlFlowExpr *expr)
@@ -264,48 +273,162 @@ void StatementVisitor::Visit(const ControlFlowExpr *expr)
 	ThrowCompileError("Control flow statement cannot be used outside of controllable expression.");
 }
 
+/**
+* @return how many times given loop accesses given variable, if it's one of the loop's candidates.
+*/
+static uint32_t UsesIn(const LoopExpr *loop, const Var *var)
+{
+	for (size_t i = 0; i < loop->varCount; i++)
+	{
+		if (loop->vars[i].id->literal == var->id)
+		{
+			return loop->vars[i].uses;
+		}
+	}
+
+	return 0;
+}
+
+StatementVisitor::LoopRegs StatementVisitor::PromoteLoopVars(const LoopExpr *loop)
+{
+	LoopRegs promoted;
+	promoted.count = 0;
+	/* Registers of this loop's variables, which are never displaced */
+	unsigned taken = 0;
+
+	for (size_t i = 0; i < loop->varCount; i++)
+	{
+		const LoopVar &candidate = loop->vars[i];
+		Var *var = GetVar(candidate.id);
+
+		/* Undefined variables are reported by the code that accesses them */
+		if (var == NULL || var->type->size != 4 || var->reg != Var::IN_MEMORY)
+		{
+			continue;
+		}
+
+		ASMReg reg = Var::IN_MEMORY;
+		/* A free register, or else the one whose variable is used the least, if it's used less than the candidate */
+		uint32_t fewest = candidate.uses;
+
+		for (ASMReg loopReg : LOOP_REGS)
+		{
+			if (!(context->loopRegs & RegAllocator::Bit(loopReg)))
+			{
+				reg = loopReg;
+				break;
+			}
+
+			uint32_t uses = UsesIn(loop, context->loopVars[(size_t) loopReg]);
+
+			if (!(taken & RegAllocator::Bit(loopReg)) && uses < fewest)
+			{
+				fewest = uses;
+				reg = loopReg;
+			}
+		}
+
+		if (reg == Var::IN_MEMORY)
+		{
+			/* The rest of the candidates are used less */
+			break;
+		}
+
+		Var *displaced = context->loopVars[(size_t) reg];
+
+		if (displaced != NULL)
+		{
+			displaced->reg = Var::IN_MEMORY;
+			asmGen->Append(ASMInstr::MOV, asmGen->VarOperand(displaced), reg, "; make room for inner loop variable");
+		}
+
+		asmGen->Append(ASMInstr::MOV, reg, asmGen->VarOperand(var), "; keep loop variable in register");
+
+		var->reg = reg;
+		context->loopRegs |= RegAllocator::Bit(reg);
+		context->loopVars[(size_t) reg] = var;
+		taken |= RegAllocator::Bit(reg);
+
+		promoted.vars[promoted.count] = var;
+		promoted.assigned[promoted.count] = candidate.assigned;
+		promoted.displaced[promoted.count] = displaced;
+		promoted.count++;
+	}
+
+	return promoted;
+}
+
+void StatementVisitor::WriteBack(const LoopRegs &promoted)
+{
+	for (size_t i = 0; i < promoted.count; i++)
+	{
+		Var *var = promoted.vars[i];
+		Var *displaced = promoted.displaced[i];
+		ASMReg reg = var->reg;
+
+		var->reg = Var::IN_MEMORY;
+
+		if (promoted.assigned[i])
+		{
+			asmGen->Append(ASMInstr::MOV, asmGen->VarOperand(var), reg, "; write back loop variable");
+		}
+
+		if (displaced != NULL)
+		{
+			asmGen->Append(ASMInstr::MOV, reg, asmGen->VarOperand(displaced), "; restore outer loop variable");
+			displaced->reg = reg;
+		}
+		else
+		{
+			context->loopRegs &= ~RegAllocator::Bit(reg);
+		}
+
+		context->loopVars[(size_t) reg] = displaced;
+	}
+}
+
 void StatementVisitor::Visit(const WhileExpr *expr)
 {
-	std::string loopStartLabel = asmGen->GenerateLabel();
-	std::string loopExitLabel = asmGen->GenerateLabel();
+	ASMLabel loopStartLabel = asmGen->GenerateLabel();
+	ASMLabel loopExitLabel = asmGen->GenerateLabel();
 
-	asmGen->AppendLine(loopStartLabel + ":");
-	expr->cond->Accept(this);
-	asmGen->AppendLine("POP eax");
-	asmGen->AppendLine("CMP eax, 0");
-	asmGen->AppendLine("JZ " + loopExitLabel);
+	LoopRegs promoted = PromoteLoopVars(expr);
+
+	asmGen->AppendLabel(loopStartLabel);
+	valueVisitor->Branch(expr->cond, loopExitLabel);
 
 	ControllableVisitor whileVisitor(this, loopStartLabel, loopExitLabel);
 	expr->block->Accept(&whileVisitor);
 
-	asmGen->AppendLine("JMP " + loopStartLabel);
-	asmGen->AppendLine(loopExitLabel + ":");
+	asmGen->Append(ASMInstr::JMP, loopStartLabel);
+	asmGen->AppendLabel(loopExitLabel);
+	WriteBack(promoted);
 }
 
 void StatementVisitor::Visit(const ForExpr *expr)
 {
-	std::string loopStartLabel = asmGen->GenerateLabel();
-	std::string loopExitLabel = asmGen->GenerateLabel();
+	ASMLabel loopStartLabel = asmGen->GenerateLabel();
+	ASMLabel loopExitLabel = asmGen->GenerateLabel();
 
 	expr->assign->Accept(this);
 
-	asmGen->AppendLine(loopStartLabel + ":");
+	LoopRegs promoted = PromoteLoopVars(expr);
+
+	asmGen->AppendLabel(loopStartLabel);
 
-	expr->cond->Accept(this);
-	asmGen->AppendLine("POP eax");
-	asmGen->AppendLine("CMP eax, 0");
-	asmGen->AppendLine("JZ " + loopExitLabel);
+	valueVisitor->Branch(expr->cond, loopExitLabel);
 
-	std::string loopIncrLabel = asmGen->GenerateLabel();
+	ASMLabel loopIncrLabel = asmGen->GenerateLabel();
 
 	ControllableVisitor whileVisitor(this, loopIncrLabel, loopExitLabel);
 	expr->block->Accept(&whileVisitor);
 
-	asmGen->AppendLine(loopIncrLabel + ":");
+	asmGen->AppendLabel(loopIncrLabel);
 	expr->incr->Accept(this);
-	asmGen->AppendLine("JMP " + loopStartLabel);
+	asmGen->Append(ASMInstr::JMP, loopStartLabel);
 
-	asmGen->AppendLine(loopExitLabel + ":");
+	asmGen->AppendLabel(loopExitLabel);
+	WriteBack(promoted);
 }
 
 void StatementVisitor::Visit(const FuncExpr *expr)
@@ -1,11 +1,17 @@
 #pragma once
 #include "IVisitor.h"
+#include "../compiler/CompileContext.h"
 
 class ValueVisitor;
+class LoopExpr;
 
 class StatementVisitor : public ChildVisitor<StatementVisitor>
 {
 protected:
+	/* The compilation this Visitor belongs to. Shared with every child Visitor */
+	CompileContext *context;
+	/* Arena that owns all of the compilation's visitor state (the context's Arena) */
+	Arena *arena;
 	/* Each StatementVisitor has a varTable that keeps track of all of its variables */
 	VarTable *varTable;
 	TypeTable *typeTable;
@@ -18,16 +24,48 @@ protected:
 	* @param expr the IfExpr to handle.
 	* @param exitLabel the label which indicates the end of the expr. If the condition doesn't hold, we go there.
 	*/
-	void VisitCondition(const IfExpr *expr, std::string &exitLabel);
+	void VisitCondition(const IfExpr *expr, ASMLabel exitLabel);
+
+	/* Most variables that loops keep in registers at once, one per callee-saved register */
+	static const size_t LOOP_REG_COUNT = 3;
+
+	/* Variables that a loop keeps in registers while it runs */
+	struct LoopRegs
+	{
+		Var *vars[LOOP_REG_COUNT];
+		/* By variable: whether the loop assigns it, so its register is written back when the loop exits */
+		bool assigned[LOOP_REG_COUNT];
+		/* By variable: the enclosing loop's variable that had its register, which gets it back when the loop exits, or NULL */
+		Var *displaced[LOOP_REG_COUNT];
+		size_t count;
+	};
+
+	/**
+	* Moves the candidates of given loop (see LoopExpr) to the registers that no enclosing loop uses, so the loop's code uses those instead of their memory.
+	* Candidates that an enclosing loop already keeps in a register stay there. Once the registers run out, a candidate takes the register of an
+	* enclosing loop's variable that this loop uses less, as an inner loop runs more often. That variable is in its memory until this loop exits.
+	* Must be called right before the loop starts, once its candidates are declared.
+	*
+	* @return the variables that were moved, for WriteBack.
+	*/
+	LoopRegs PromoteLoopVars(const LoopExpr *loop);
+	/**
+	* Writes the variables that a loop assigned back to their memory, and gives their registers back to the variables they displaced, or frees them.
+	* Must be called where every exit of the loop leads (its exit label, which break jumps to).
+	*/
+	void WriteBack(const LoopRegs &promoted);
+
+	/* StatementVisitor with given super Visitor (may be null), that belongs to given compilation */
+	StatementVisitor(StatementVisitor *superVisitor, CompileContext *context);
 
 public:
-	/* Each StatementVisitor has an ASMGenerator that it uses to create the ASM file. Feels unsafe to have this public, but will do for now */
+	/* Each StatementVisitor has an ASMGenerator (the context's ASMGenerator) that it uses to create the ASM file. Feels unsafe to have this public, but will do for now */
 	ASMGenerator *asmGen;
 
 	/* StatementVisitor that has a super Visitor */
 	StatementVisitor(StatementVisitor *visitor);
-	/* StatementVisitor that has no super Visitor (the first StatementVisitor) */
-	StatementVisitor();
+	/* StatementVisitor that has no super Visitor (the first StatementVisitor) of given compilation */
+	StatementVisitor(CompileContext *context);
 
 	/**
 	* Wrapper function for getting a variable.
@@ -43,7 +81,7 @@ public:
 	void Visit(const TernExpr *expr) override;
 	void Visit(const CondExpr *expr) override;
 	void Visit(const AccessibleExpr *expr);
-	void Visit(const ArrayExpr *expr) override {} // Unimplemented
+	void Visit(const ArrayExpr *) override {} // Unimplemented
 	void Visit(const PrintExpr *expr) override;
 	void Visit(const AssignExpr *expr) override;
 	void Visit(const InitExpr *expr) override;
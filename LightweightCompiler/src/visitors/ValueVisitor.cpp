@@ -1,8 +1,11 @@
 #include "../compiler/Compiler.h"
 
-ValueVisitor::ValueVisitor(StatementVisitor *superVisitor) :
+ValueVisitor::ValueVisitor(StatementVisitor *superVisitor, ASMGenerator *asmGen, const unsigned *loopRegs) :
 	ChildVisitor(superVisitor),
-	returnType(NULL)
+	returnType(NULL),
+	allocator(asmGen, loopRegs),
+	branchFrame(NO_BRANCH),
+	branchLabel{ 0 }
 {
 }
 
@@ -11,19 +14,122 @@ const Type *ValueVisitor::GetType()
 	return returnType;
 }
 
+ValueVisitor::Frame &ValueVisitor::Current()
+{
+	return frames.back();
+}
+
+void ValueVisitor::Descend(const Expr *expr, uint8_t nextStage, bool operand)
+{
+	Current().stage = nextStage;
+	frames.push_back(Frame{ expr, 0, operand, NULL, ASMLabel(), ASMLabel() });
+}
+
+void ValueVisitor::Replace(const Expr *expr)
+{
+	Current() = Frame{ expr, 0, Current().operand, NULL, ASMLabel(), ASMLabel() };
+}
+
+void ValueVisitor::Complete()
+{
+	frames.pop_back();
+}
+
+void ValueVisitor::CompleteLeaf(ASMOperand value)
+{
+	if (Current().operand)
+	{
+		operand = value;
+	}
+	else
+	{
+		superVisitor->asmGen->Append(ASMInstr::MOV, allocator.Allocate(), value);
+	}
+
+	Complete();
+}
+
+void ValueVisitor::Evaluate(const Expr *expr)
+{
+	size_t base = frames.size();
+	frames.push_back(Frame{ expr, 0, false, NULL, ASMLabel(), ASMLabel() });
+
+	/* Visit the innermost expression until the given expression is complete */
+	while (frames.size() > base)
+	{
+		Current().expr->Accept(this);
+	}
+
+	allocator.Store();
+}
+
+ASMOperand ValueVisitor::EvaluateOperand(const Expr *expr, bool memory)
+{
+	size_t base = frames.size();
+	frames.push_back(Frame{ expr, 0, expr->registers == 0, NULL, ASMLabel(), ASMLabel() });
+
+	while (frames.size() > base)
+	{
+		Current().expr->Accept(this);
+	}
+
+	if (expr->registers == 0 && !(operand.kind == ASMOperand::REG && allocator.Holds(operand.reg)))
+	{
+		if (memory || operand.kind != ASMOperand::MEM)
+		{
+			return operand;
+		}
+
+		superVisitor->asmGen->Append(ASMInstr::MOV, allocator.Allocate(), operand);
+	}
+
+	/* The value's register stays as it is until something else is evaluated */
+	allocator.Load(1);
+	ASMReg reg = allocator.Reg(0);
+	allocator.Pop();
+
+	return reg;
+}
+
+void ValueVisitor::Branch(const Expr *cond, ASMLabel falseLabel)
+{
+	size_t base = frames.size();
+	size_t count = allocator.Count();
+
+	frames.push_back(Frame{ cond, 0, false, NULL, ASMLabel(), ASMLabel() });
+	branchFrame = base;
+	branchLabel = falseLabel;
+
+	while (frames.size() > base)
+	{
+		Current().expr->Accept(this);
+	}
+
+	branchFrame = NO_BRANCH;
+
+	/* Any other condition is a value that's compared with false */
+	if (allocator.Count() > count)
+	{
+		allocator.Load(1);
+		superVisitor->asmGen->Append(ASMInstr::CMP, allocator.Reg(0), ASMOperand::Imm(0), ";; Check condition result");
+		superVisitor->asmGen->Append(ASMInstr::JZ, falseLabel, ";; If condition is false, jump to false label");
+		allocator.Pop();
+	}
+}
+
 void ValueVisitor::Visit(const LitExpr *expr)
 {
 	if (expr->value->type == TokenType::BOOL)
 	{
-		superVisitor->asmGen->PushValue(expr->value->literal == Token::FALSE_LITERAL ? "0" : "1");
 		returnType = TypeTable::TYPE_BOOL;
+		CompleteLeaf(ASMOperand::Imm(expr->value->literal == Token::FALSE_LITERAL ? 0 : 1));
 		return;
 	}
 
 	if (expr->value->type == TokenType::INT)
 	{
-		superVisitor->asmGen->PushValue(expr->value->literal);
 		returnType = TypeTable::TYPE_INT;
+		CompleteLeaf(superVisitor->asmGen->Literal(expr->value->literal));
 		return;
 	}
 
@@ -37,175 +143,245 @@ void ValueVisitor::Visit(const AccessibleExpr *expr)
 
 	if (var == NULL)
 	{
-		ThrowCompileError("Invalid accessor name " + id->literal);
+		ThrowCompileError("Invalid accessor name " + std::string(id->literal));
 	}
 
 	//don't use this, there are multiple types
 	//superVisitor->asmGen->PushValue("DWORD [ebp-" + std::to_string(var->memOffset) + "]");
 
-	switch (var->type->size)
+	returnType = var->type;
+
+	if (var->type->size == 4)
 	{
-	case 4:
-		superVisitor->asmGen->AppendLine("PUSH DWORD [ebp-" + std::to_string(var->memOffset) + "]");
-		break;
+		CompleteLeaf(superVisitor->asmGen->VarOperand(var));
+		return;
+	}
 
-	case 2:
-		superVisitor->asmGen->AppendLine("PUSH WORD [ebp-" + std::to_string(var->memOffset) + "]");
-		break;
+	/* Smaller variables are zero-extended to a whole register, even as operands */
+	ASMReg reg = allocator.Allocate();
+	superVisitor->asmGen->Append(ASMInstr::MOVZX, reg, ASMOperand::Mem(var->type->size == 2 ? ASMSize::WORD : ASMSize::BYTE, superVisitor->asmGen->StackOffset(var)));
 
-	case 1:
-		superVisitor->asmGen->AppendLine("MOVZX eax, BYTE [ebp-" + std::to_string(var->memOffset) + "]");
-		superVisitor->asmGen->AppendLine("PUSH eax");
-		break;
+	if (Current().operand)
+	{
+		operand = reg;
 	}
 
-	returnType = var->type;
+	Complete();
 }
 
-void ValueVisitor::AppendNot()
+void ValueVisitor::AppendNot(ASMReg reg)
 {
-	std::string isFalse = superVisitor->asmGen->GenerateLabel();
-	std::string exit = superVisitor->asmGen->GenerateLabel();
-
-	superVisitor->asmGen->AppendLine("POP edx");
+	ASMLabel isFalse = superVisitor->asmGen->GenerateLabel();
+	ASMLabel exit = superVisitor->asmGen->GenerateLabel();
 
-	superVisitor->asmGen->AppendLine("CMP edx, 0");
-	superVisitor->asmGen->AppendLine("JZ " + isFalse);
+	superVisitor->asmGen->Append(ASMInstr::CMP, reg, ASMOperand::Imm(0));
+	superVisitor->asmGen->Append(ASMInstr::JZ, isFalse);
 
-	superVisitor->asmGen->AppendLine("PUSH 0");
-	superVisitor->asmGen->AppendLine("JMP " + exit);
-	superVisitor->asmGen->AppendLine(isFalse + ": PUSH 1");
-	superVisitor->asmGen->AppendLine(exit + ":");
+	superVisitor->asmGen->Append(ASMInstr::MOV, reg, ASMOperand::Imm(0));
+	superVisitor->asmGen->Append(ASMInstr::JMP, exit);
+	superVisitor->asmGen->AppendLabel(isFalse, true);
+	superVisitor->asmGen->Append(ASMInstr::MOV, reg, ASMOperand::Imm(1));
+	superVisitor->asmGen->AppendLabel(exit);
 }
 
 void ValueVisitor::Visit(const UnaryExpr *expr)
 {
-	expr->value->Accept(this);
+	if (Current().stage == 0)
+	{
+		Descend(expr->value, 1);
+		return;
+	}
+
+	allocator.Load(1);
 
 	switch (expr->oper->type)
 	{
 	case TokenType::SUB:
-		superVisitor->asmGen->AppendUnary(ASMInstr::NEG);
+		superVisitor->asmGen->Append(ASMInstr::NEG, allocator.Reg(0));
 		break;
 
 	case TokenType::NOT:
-		AppendNot();
+		AppendNot(allocator.Reg(0));
 		break;
 	}
 
 	superVisitor->asmGen->AppendSpace();
+	Complete();
 }
 
-void ValueVisitor::AppendAnd(const BinaryExpr *expr)
+void ValueVisitor::AppendAnd(ASMReg left, ASMReg right)
 {
-	std::string hasZero = superVisitor->asmGen->GenerateLabel();
-	std::string exit = superVisitor->asmGen->GenerateLabel();
+	ASMLabel hasZero = superVisitor->asmGen->GenerateLabel();
+	ASMLabel exit = superVisitor->asmGen->GenerateLabel();
+
+	superVisitor->asmGen->Append(ASMInstr::CMP, left, ASMOperand::Imm(0));
+	superVisitor->asmGen->Append(ASMInstr::JZ, hasZero);
+	superVisitor->asmGen->Append(ASMInstr::CMP, right, ASMOperand::Imm(0));
+	superVisitor->asmGen->Append(ASMInstr::JZ, hasZero);
+
+	superVisitor->asmGen->Append(ASMInstr::MOV, left, ASMOperand::Imm(1));
+	superVisitor->asmGen->Append(ASMInstr::JMP, exit);
+	superVisitor->asmGen->AppendLabel(hasZero, true);
+	superVisitor->asmGen->Append(ASMInstr::MOV, left, ASMOperand::Imm(0));
+	superVisitor->asmGen->AppendLabel(exit);
+}
 
-	superVisitor->asmGen->AppendLine("POP eax");
-	superVisitor->asmGen->AppendLine("POP ebx");
+void ValueVisitor::AppendOr(ASMReg left, ASMReg right)
+{
+	ASMLabel hasOne = superVisitor->asmGen->GenerateLabel();
+	ASMLabel exit = superVisitor->asmGen->GenerateLabel();
+
+	superVisitor->asmGen->Append(ASMInstr::CMP, left, ASMOperand::Imm(0));
+	superVisitor->asmGen->Append(ASMInstr::JNZ, hasOne);
+	superVisitor->asmGen->Append(ASMInstr::CMP, right, ASMOperand::Imm(0));
+	superVisitor->asmGen->Append(ASMInstr::JNZ, hasOne);
+
+	superVisitor->asmGen->Append(ASMInstr::MOV, left, ASMOperand::Imm(0));
+	superVisitor->asmGen->Append(ASMInstr::JMP, exit);
+	superVisitor->asmGen->AppendLabel(hasOne, true);
+	superVisitor->asmGen->Append(ASMInstr::MOV, left, ASMOperand::Imm(1));
+	superVisitor->asmGen->AppendLabel(exit);
+}
+
+ASMReg ValueVisitor::AppendDivision(bool modulo, size_t leftDepth)
+{
+	size_t rightDepth = 1 - leftDepth;
+	unsigned divided = RegAllocator::Bit(ASMReg::EAX) | RegAllocator::Bit(ASMReg::EDX);
+
+	/* IDIV divides edx:eax, so the dividend goes to eax & the divisor to any other register but edx. No other value may stay in them */
+	allocator.SpillBelow(2);
+	/* The dividend is moved first, since while loop variables reserve registers, edx may be the only free one until then */
+	allocator.Move(leftDepth, ASMReg::EAX);
+
+	if (RegAllocator::Bit(allocator.Reg(rightDepth)) & divided)
+	{
+		allocator.Move(rightDepth, allocator.FreeReg(divided));
+	}
 
-	superVisitor->asmGen->AppendLine("CMP eax, 0");
-	superVisitor->asmGen->AppendLine("JZ " + hasZero);
-	superVisitor->asmGen->AppendLine("CMP ebx, 0");
-	superVisitor->asmGen->AppendLine("JZ " + hasZero);
+	superVisitor->asmGen->Append(ASMInstr::MOV, ASMReg::EDX, ASMOperand::Imm(0));
+	superVisitor->asmGen->Append(ASMInstr::IDIV, allocator.Reg(rightDepth));
 
-	superVisitor->asmGen->AppendLine("PUSH 1");
-	superVisitor->asmGen->AppendLine("JMP " + exit);
-	superVisitor->asmGen->AppendLine(hasZero + ": PUSH 0");
-	superVisitor->asmGen->AppendLine(exit + ":");
+	/* The quotient is in eax, the remainder in edx */
+	return modulo ? ASMReg::EDX : ASMReg::EAX;
 }
 
-void ValueVisitor::AppendOr(const BinaryExpr *expr)
+ASMReg ValueVisitor::AppendPower(size_t leftDepth)
 {
-	std::string hasOne = superVisitor->asmGen->GenerateLabel();
-	std::string exit = superVisitor->asmGen->GenerateLabel();
+	/* The base (in edx) is multiplied into eax as many times as the exponent (in ecx, the loop's counter). No other value may stay in them */
+	allocator.SpillBelow(2);
+	allocator.Move(1 - leftDepth, ASMReg::ECX);
+	allocator.Move(leftDepth, ASMReg::EDX);
 
-	superVisitor->asmGen->AppendLine("POP eax");
-	superVisitor->asmGen->AppendLine("POP ebx");
-
-	superVisitor->asmGen->AppendLine("CMP eax, 0");
-	superVisitor->asmGen->AppendLine("JNZ " + hasOne);
-	superVisitor->asmGen->AppendLine("CMP ebx, 0");
-	superVisitor->asmGen->AppendLine("JNZ " + hasOne);
+	superVisitor->asmGen->Append(ASMInstr::MOV, ASMReg::EAX, ASMOperand::Imm(1));
+	superVisitor->asmGen->AppendSpace();
+	superVisitor->asmGen->EnterLoop();
+	superVisitor->asmGen->Append(ASMInstr::IMUL, ASMReg::EAX, ASMReg::EDX);
+	superVisitor->asmGen->ExitLoop();
 
-	superVisitor->asmGen->AppendLine("PUSH 0");
-	superVisitor->asmGen->AppendLine("JMP " + exit);
-	superVisitor->asmGen->AppendLine(hasOne + ": PUSH 1");
-	superVisitor->asmGen->AppendLine(exit + ":");
+	return ASMReg::EAX;
 }
 
-void ValueVisitor::AppendModulo()
+/**
+* @return whether given binary operator's instruction can take its right operand as is: an immediate or a variable's memory.
+*/
+static bool TakesOperand(TokenType oper)
 {
-	superVisitor->asmGen->AppendLine("POP eax");
-	superVisitor->asmGen->AppendLine("MOV edx, 0");
-	superVisitor->asmGen->AppendLine("POP ebx");
-	superVisitor->asmGen->AppendLine("IDIV ebx");
-	superVisitor->asmGen->AppendLine("PUSH edx");
+	switch (oper)
+	{
+	case TokenType::ADD:
+	case TokenType::SUB:
+	case TokenType::MULT:
+	case TokenType::EQEQ:
+	case TokenType::NEQ:
+	case TokenType::GRTR:
+	case TokenType::GEQ:
+	case TokenType::LESS:
+	case TokenType::LEQ:
+		return true;
+
+	default:
+		break;
+	}
+
+	return false;
 }
 
 void ValueVisitor::Visit(const BinaryExpr *expr)
 {
-	/* We push values from right to left due to ASM's LIFO stack */
-	expr->right->Accept(this); // Push evaluated right expression onto the ASM stack
-	const Type *right = returnType;
-	expr->left->Accept(this); // Push evaluated left expression onto the ASM stack
-	const Type *left = returnType;
+	/* Sethi-Ullman order: the operand that needs more registers is evaluated first, so the other one's value holds a register for less time.
+	* A right operand that needs none (a literal or a variable) isn't loaded to a register, but used by the instruction as is */
+	TokenType oper = expr->oper->type;
+	bool direct = expr->right->registers == 0 && TakesOperand(oper);
+	bool rightFirst = !direct && expr->right->registers > std::max<uint8_t>(expr->left->registers, 1);
+
+	switch (Current().stage)
+	{
+	case 0:
+		Descend(rightFirst ? expr->right : expr->left, 1);
+		return;
+
+	case 1:
+		Current().type = returnType;
+		Descend(rightFirst ? expr->left : expr->right, 2, direct);
+		return;
+	}
+
+	const Type *right = rightFirst ? Current().type : returnType;
+	const Type *left = rightFirst ? returnType : Current().type;
 
 	bool hasFloat = right == TypeTable::TYPE_FLOAT || left == TypeTable::TYPE_FLOAT;
+	returnType = left;
 
-	switch (expr->oper->type)
+	/* The left operand is the allocator's value that was evaluated first or second; the right one is either the other value or an operand as is.
+	* An operand in a register is the allocator's value, unless it's a variable that a loop keeps in a register */
+	bool rightInRegister = !direct || (operand.kind == ASMOperand::REG && allocator.Holds(operand.reg));
+	size_t leftDepth = rightFirst || !rightInRegister ? 0 : 1;
+
+	allocator.Load(rightInRegister ? 2 : 1);
+
+	ASMReg dst = allocator.Reg(leftDepth);
+	ASMOperand src = rightInRegister ? ASMOperand(allocator.Reg(1 - leftDepth)) : operand;
+	bool branched = false;
+
+	switch (oper)
 	{
 	case TokenType::ADD:
-		superVisitor->asmGen->AppendBinary(ASMInstr::ADD);
+		superVisitor->asmGen->Append(ASMInstr::ADD, dst, src);
 		if (hasFloat) returnType = TypeTable::TYPE_FLOAT;
 		break;
 
 	case TokenType::SUB:
-		superVisitor->asmGen->AppendBinary(ASMInstr::SUB);
+		superVisitor->asmGen->Append(ASMInstr::SUB, dst, src);
 		if (hasFloat) returnType = TypeTable::TYPE_FLOAT;
 		break;
 
 	case TokenType::MULT:
-		superVisitor->asmGen->AppendBinary(ASMInstr::IMUL);
+		superVisitor->asmGen->Append(ASMInstr::IMUL, dst, src);
 		if (hasFloat) returnType = TypeTable::TYPE_FLOAT;
 		break;
 
 	case TokenType::DIV:
-		//asmGen->PopValue(ASMReg::EAX); // Extract numerator to EAX
-		//asmGen->AppendUnary(ASMInstr::IDIV); // Let method extract denominator
-
-		superVisitor->asmGen->AppendLine("POP eax");
-		superVisitor->asmGen->AppendLine("MOV edx, 0");
-		superVisitor->asmGen->AppendLine("POP ebx");
-		superVisitor->asmGen->AppendLine("IDIV ebx");
-		superVisitor->asmGen->AppendLine("PUSH eax");
-
+		dst = AppendDivision(false, leftDepth);
 		if (hasFloat) returnType = TypeTable::TYPE_FLOAT;
 		break;
 
 	case TokenType::MOD:
 		if (hasFloat) ThrowCompileError("Illegal operator for Floats");
-		AppendModulo();
+		dst = AppendDivision(true, leftDepth);
 		break;
 
 	case TokenType::AND:
 		if (hasFloat) ThrowCompileError("Illegal operator for Floats");
-		AppendAnd(expr);
+		AppendAnd(dst, src.reg);
 		break;
 
 	case TokenType::OR:
 		if (hasFloat) ThrowCompileError("Illegal operator for Floats");
-		AppendOr(expr);
+		AppendOr(dst, src.reg);
 		break;
 
 	case TokenType::POW:
-		superVisitor->asmGen->PopValue(ASMReg::EBX);
-		superVisitor->asmGen->AppendLine("MOV eax, 1");
-		superVisitor->asmGen->AppendSpace();
-		superVisitor->asmGen->EnterLoop();
-		superVisitor->asmGen->AppendLine("IMUL eax, ebx");
-		superVisitor->asmGen->ExitLoop();
-		superVisitor->asmGen->AppendLine("PUSH eax");
+		dst = AppendPower(leftDepth);
 		break;
 
 	case TokenType::EQEQ:
@@ -214,86 +390,181 @@ void ValueVisitor::Visit(const BinaryExpr *expr)
 	case TokenType::GEQ:
 	case TokenType::LESS:
 	case TokenType::LEQ:
-		AppendCondition(expr->oper->type);
+		if (frames.size() - 1 == branchFrame)
+		{
+			AppendBranch(oper, dst, src);
+			branched = true;
+		}
+		else
+		{
+			AppendCondition(oper, dst, src);
+		}
+
 		returnType = TypeTable::TYPE_BOOL;
 		break;
 	}
 
+	/* The operands' values are replaced by the result's, unless the result was a jump */
+	if (rightInRegister)
+	{
+		allocator.Pop();
+	}
+
+	allocator.Pop();
+
+	if (!branched)
+	{
+		allocator.Push(dst);
+	}
+
 	superVisitor->asmGen->AppendSpace();
+	Complete();
 }
 
-std::string GetConditionInstr(TokenType cond)
+ASMInstr GetConditionInstr(TokenType cond)
 {
 	switch (cond)
 	{
 	case TokenType::EQEQ:
-		return "JE";
+		return ASMInstr::JE;
 	case TokenType::NEQ:
-		return "JNE";
+		return ASMInstr::JNE;
 	case TokenType::GRTR:
-		return "JG";
+		return ASMInstr::JG;
 	case TokenType::GEQ:
-		return "JGE";
+		return ASMInstr::JGE;
 	case TokenType::LESS:
-		return "JL";
+		return ASMInstr::JL;
 	case TokenType::LEQ:
-		return "JLE";
+		return ASMInstr::JLE;
+	default:
+		break;
+	}
+
+	ThrowCompileError("Invalid condition.");
+	return ASMInstr::JE;
+}
+
+/**
+* @return the jump that's taken when the comparison of given jump isn't.
+*/
+static ASMInstr InverseJump(ASMInstr jump)
+{
+	switch (jump)
+	{
+	case ASMInstr::JE:
+		return ASMInstr::JNE;
+	case ASMInstr::JNE:
+		return ASMInstr::JE;
+	case ASMInstr::JG:
+		return ASMInstr::JLE;
+	case ASMInstr::JGE:
+		return ASMInstr::JL;
+	case ASMInstr::JL:
+		return ASMInstr::JGE;
+	case ASMInstr::JLE:
+		return ASMInstr::JG;
+	default:
+		break;
 	}
 
-	return "Invalid condition.";
+	return jump;
 }
 
-void ValueVisitor::AppendCondition(TokenType cond)
+void ValueVisitor::AppendBranch(TokenType cond, ASMReg left, ASMOperand right)
 {
-	std::string instr = GetConditionInstr(cond);
-	std::string caseTrueLabel = superVisitor->asmGen->GenerateLabel();
-	std::string condExitLabel = superVisitor->asmGen->GenerateLabel();
-
-	superVisitor->asmGen->AppendLine("POP eax");
-	superVisitor->asmGen->AppendLine("POP ebx");
-	superVisitor->asmGen->AppendLine("cmp eax, ebx");
-	superVisitor->asmGen->AppendLine(instr + " " + caseTrueLabel);
-	superVisitor->asmGen->AppendLine("PUSH 0");
-	superVisitor->asmGen->AppendLine("JMP " + condExitLabel);
-	superVisitor->asmGen->AppendLine(caseTrueLabel + ": PUSH 1");
-	superVisitor->asmGen->AppendLine(condExitLabel + ":");
+	superVisitor->asmGen->Append(ASMInstr::CMP, left, right);
+	superVisitor->asmGen->Append(InverseJump(GetConditionInstr(cond)), branchLabel);
+}
+
+void ValueVisitor::AppendCondition(TokenType cond, ASMReg left, ASMOperand right)
+{
+	ASMInstr instr = GetConditionInstr(cond);
+	ASMLabel caseTrueLabel = superVisitor->asmGen->GenerateLabel();
+	ASMLabel condExitLabel = superVisitor->asmGen->GenerateLabel();
+
+	superVisitor->asmGen->Append(ASMInstr::CMP, left, right);
+	superVisitor->asmGen->Append(instr, caseTrueLabel);
+	superVisitor->asmGen->Append(ASMInstr::MOV, left, ASMOperand::Imm(0));
+	superVisitor->asmGen->Append(ASMInstr::JMP, condExitLabel);
+	superVisitor->asmGen->AppendLabel(caseTrueLabel, true);
+	superVisitor->asmGen->Append(ASMInstr::MOV, left, ASMOperand::Imm(1));
+	superVisitor->asmGen->AppendLabel(condExitLabel);
 }
 
 void ValueVisitor::Visit(const GroupExpr *expr)
 {
 	superVisitor->asmGen->AppendComment("Evaluate Group");
-	expr->value->Accept(this);
+	Replace(expr->value);
 }
 
 void ValueVisitor::Visit(const TernExpr *expr)
 {
-	std::string caseFalseLabel = superVisitor->asmGen->GenerateLabel(); // Incase cond is false
-	std::string condExitLabel = superVisitor->asmGen->GenerateLabel(); // End of entire cond expression
+	Frame &frame = Current();
 
-	expr->cond->Accept(this); // Pushes condition result into stack
+	switch (frame.stage)
+	{
+	case 0:
+		frame.falseLabel = superVisitor->asmGen->GenerateLabel(); // Incase cond is false
+		frame.exitLabel = superVisitor->asmGen->GenerateLabel(); // End of entire cond expression
 
-	superVisitor->asmGen->AppendLine("POP eax ;; Save condition result");
-	superVisitor->asmGen->AppendLine("CMP eax, 0");
-	superVisitor->asmGen->AppendLine("JZ " + caseFalseLabel + " ;; If conditin is false, jump to false label");
-	superVisitor->asmGen->AppendSpace();
-	expr->caseTrue->Accept(this);
-	const Type *trueType = returnType;
-	superVisitor->asmGen->AppendLine("JMP " + condExitLabel + " ;; Skip false condition");
-	superVisitor->asmGen->AppendSpace();
-	superVisitor->asmGen->AppendLine(caseFalseLabel + ":");
-	expr->caseFalse->Accept(this);
+		Descend(expr->cond, 1); // Pushes condition result into stack
+		return;
+
+	case 1:
+		/* Both cases start with every other value spilled, and end with their value in eax, so the values are in the same places after either */
+		allocator.Load(1);
+		allocator.SpillBelow(1);
+
+		superVisitor->asmGen->Append(ASMInstr::CMP, allocator.Reg(0), ASMOperand::Imm(0), ";; Check condition result");
+		superVisitor->asmGen->Append(ASMInstr::JZ, frame.falseLabel, ";; If conditin is false, jump to false label");
+		superVisitor->asmGen->AppendSpace();
+		allocator.Pop();
+		Descend(expr->caseTrue, 2);
+		return;
+
+	case 2:
+		frame.type = returnType;
+		allocator.Load(1);
+		allocator.Move(0, ASMReg::EAX);
+		allocator.Pop();
+		superVisitor->asmGen->Append(ASMInstr::JMP, frame.exitLabel, ";; Skip false condition");
+		superVisitor->asmGen->AppendSpace();
+		superVisitor->asmGen->AppendLabel(frame.falseLabel);
+		Descend(expr->caseFalse, 3);
+		return;
+	}
+
+	const Type *trueType = frame.type;
 	const Type *falseType = returnType;
-	superVisitor->asmGen->AppendLine(condExitLabel + ":");
+	allocator.Load(1);
+	allocator.Move(0, ASMReg::EAX);
+	superVisitor->asmGen->AppendLabel(frame.exitLabel);
 	superVisitor->asmGen->AppendSpace();
 
 	if (trueType != falseType)
 	{
 		ThrowCompileError("Ternary expression results must have same type");
 	}
+
+	Complete();
 }
 
 void ValueVisitor::Visit(const CondExpr *expr)
 {
-	expr->cond->Accept(this);
+	if (frames.size() - 1 == branchFrame)
+	{
+		/* A branch doesn't need the condition as a bool, so its comparison is the branch's */
+		Replace(expr->cond);
+		return;
+	}
+
+	if (Current().stage == 0)
+	{
+		Descend(expr->cond, 1);
+		return;
+	}
+
 	returnType = TypeTable::TYPE_BOOL;
+	Complete();
 }
\ No newline at end of file
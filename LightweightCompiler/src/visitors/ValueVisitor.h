@@ -1,5 +1,9 @@
 #pragma once
 #include "IVisitor.h"
+#include "../asm/RegAllocator.h"
+#include <cstdint>
+#include <string>
+#include <vector>
 
 class StatementVisitor;
 
@@ -11,32 +15,120 @@ class StatementVisitor;
 class ValueVisitor : public ChildVisitor<StatementVisitor>
 {
 private:
+	/**
+	* Value expression whose evaluation is in progress.
+	* Evaluation doesn't recurse into sub-expressions: a Visit pushes a frame for the sub-expression & returns, and is visited again
+	* (with its frame's next stage) once the sub-expression was evaluated. Nesting depth therefore costs frames, not native stack.
+	*/
+	struct Frame
+	{
+		const Expr *expr;
+		/* How many of the expression's sub-expressions were evaluated */
+		uint8_t stage;
+		/* Whether the parent expression uses the value as an operand, so a leaf may leave it where it is instead of loading it (see operand) */
+		bool operand;
+		/* Type of an already evaluated sub-expression (BinaryExpr's right operand, TernExpr's true case) */
+		const Type *type;
+		/* Labels generated before evaluating the sub-expressions (TernExpr) */
+		ASMLabel falseLabel, exitLabel;
+	};
+
 	/**
 	* A ValueVisitor keeps track of the evaluated value's Type.
 	* This is a replacement for a generic return-type visitor pattern.
 	*/
 	const Type *returnType;
+	/* Expressions being evaluated, innermost last. The innermost frame is the one being visited */
+	std::vector<Frame> frames;
+	/* Registers of the evaluated values that weren't used yet */
+	RegAllocator allocator;
+	/**
+	* Value of the last expression that was evaluated as an operand: an immediate, a variable's memory,
+	* or a register if it had to be loaded (in which case it's also the allocator's newest value).
+	*/
+	ASMOperand operand;
+	/* Frame of the condition being evaluated by Branch, or NO_BRANCH. A comparison in it jumps to branchLabel instead of producing a value */
+	size_t branchFrame;
+	ASMLabel branchLabel;
 
-	/* Handles boolean NOT on value that's pushed to stack. */
-	void AppendNot();
-	/* Handles boolean AND on given BinaryExpr */
-	void AppendAnd(const BinaryExpr *expr);
-	/* Handles boolean OR on given BinaryExpr */
-	void AppendOr(const BinaryExpr *expr);
-	/* Handles MODULO operation on two ints pushed to stack */
-	void AppendModulo();
-	/* Appends ASM condition matching given condition type (==, !=, >, etc) */
-	void AppendCondition(TokenType cond);
+	static const size_t NO_BRANCH = SIZE_MAX;
+
+	/**
+	* @return the frame of the expression being visited.
+	*/
+	Frame &Current();
+	/**
+	* Evaluates given sub-expression next, then visits the current expression again at given stage.
+	*
+	* @param operand whether the value is used as an operand, see Frame.
+	*/
+	void Descend(const Expr *expr, uint8_t nextStage, bool operand = false);
+	/**
+	* Replaces the current expression with given sub-expression, for expressions that have nothing left to do after it.
+	*/
+	void Replace(const Expr *expr);
+	/**
+	* Completes the current expression. returnType must hold its Type.
+	*/
+	void Complete();
+	/**
+	* Completes the current expression, a leaf with given value: as the parent's operand if it wants one, or loaded to a new register.
+	*/
+	void CompleteLeaf(ASMOperand value);
+
+	/* Handles boolean NOT on value in given register */
+	void AppendNot(ASMReg reg);
+	/* Handles boolean AND on values in given registers, leaving the result in the left one */
+	void AppendAnd(ASMReg left, ASMReg right);
+	/* Handles boolean OR on values in given registers, leaving the result in the left one */
+	void AppendOr(ASMReg left, ASMReg right);
+	/**
+	* Handles DIVISION & MODULO on the allocator's 2 newest values.
+	*
+	* @param leftDepth the dividend's depth in the allocator (see RegAllocator::Reg).
+	* @return the register of the result.
+	*/
+	ASMReg AppendDivision(bool modulo, size_t leftDepth);
+	/**
+	* Handles POWER on the allocator's 2 newest values.
+	*
+	* @param leftDepth the base's depth in the allocator (see RegAllocator::Reg).
+	* @return the register of the result.
+	*/
+	ASMReg AppendPower(size_t leftDepth);
+	/* Appends ASM condition matching given condition type (==, !=, >, etc), leaving the result in the left register */
+	void AppendCondition(TokenType cond, ASMReg left, ASMOperand right);
+	/* Appends ASM condition matching given condition type, that jumps to branchLabel if it doesn't hold */
+	void AppendBranch(TokenType cond, ASMReg left, ASMOperand right);
 
 public:
 	/**
-	* Construct new ValueVisitor with given BaseVisitor as its caller.
+	* Construct new ValueVisitor with given BaseVisitor as its caller, that appends code to given ASMGenerator.
+	*
+	* @param loopRegs registers that hold loop variables (see CompileContext), which values mustn't use.
 	*/
-	ValueVisitor(StatementVisitor *superVisitor);
+	ValueVisitor(StatementVisitor *superVisitor, ASMGenerator *asmGen, const unsigned *loopRegs);
 	/**
 	* Get the evaluated Type.
 	*/
 	const Type *GetType();
+	/**
+	* Evaluates given value expression, pushing its value onto the ASM stack.
+	* Uses the same amount of native stack for any expression depth. Values in between are kept in registers (see RegAllocator).
+	*/
+	void Evaluate(const Expr *expr);
+	/**
+	* Evaluates given value expression as an instruction's operand, without pushing it.
+	*
+	* @param memory whether the operand may be a variable's memory, or must be loaded if it is.
+	* @return the value: an immediate, a variable's memory or register, or a register that holds it until the next evaluation.
+	*/
+	ASMOperand EvaluateOperand(const Expr *expr, bool memory);
+	/**
+	* Evaluates given condition & jumps to given label if it's false, without keeping its value.
+	* A condition that compares 2 values jumps on the comparison itself.
+	*/
+	void Branch(const Expr *cond, ASMLabel falseLabel);
 
 	/* ValueVisitor handles all value expressions */
 	void Visit(const LitExpr *expr);
@@ -47,15 +139,15 @@ public:
 	void Visit(const CondExpr *expr);
 	void Visit(const AccessibleExpr *expr);
 
-	/* Will not encounter/handle any of these expressions */
-	void Visit(const ArrayExpr *expr) {}
-	void Visit(const PrintExpr *expr) {}
-	void Visit(const AssignExpr *expr) {}
-	void Visit(const InitExpr *expr) {}
-	void Visit(const IfExpr *expr) {}
-	void Visit(const ElseExpr *expr) {}
-	void Visit(const ControlFlowExpr *expr) {}
-	void Visit(const WhileExpr *expr) {}
-	void Visit(const ForExpr *expr) {}
-	void Visit(const ExprGroup *block) {}
+	/* Will not encounter/handle any of these expressions. They're completed without evaluating anything, so evaluation doesn't get stuck on them */
+	void Visit(const ArrayExpr *) { Complete(); }
+	void Visit(const PrintExpr *) { Complete(); }
+	void Visit(const AssignExpr *) { Complete(); }
+	void Visit(const InitExpr *) { Complete(); }
+	void Visit(const IfExpr *) { Complete(); }
+	void Visit(const ElseExpr *) { Complete(); }
+	void Visit(const ControlFlowExpr *) { Complete(); }
+	void Visit(const WhileExpr *) { Complete(); }
+	void Visit(const ForExpr *) { Complete(); }
+	void Visit(const ExprGroup *) { Complete(); }
 };
\ No newline at end of file